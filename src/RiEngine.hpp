@@ -2,5 +2,10 @@
 #include "RiEngine/pch/pch.hpp"
 #include "RiEngine/Exception.hpp"
 #include "RiEngine/Format.hpp"
+#include "RiEngine/FormatPacking.hpp"
+#include "RiEngine/ThreadPool.hpp"
+#include "RiEngine/StringHash.hpp"
+#include "RiEngine/Culling.hpp"
+#include "RiEngine/Compression.hpp"
 #include "RiEngine/loaders/MeshLoader.hpp"
 
@@ -0,0 +1,241 @@
+#include "Compression.hpp"
+
+namespace rise {
+    namespace {
+        constexpr Size minMatch = 4;
+        constexpr Size maxOffset = std::numeric_limits<uint16_t>::max();
+        constexpr Size hashBits = 14;
+        // token nibble value that continues a length in following bytes
+        constexpr Size lengthMask = 15;
+
+        // first byte of a block
+        enum BlockMode : uint8_t {
+            Plain,
+            Filtered,
+            Stored,
+        };
+
+        uint32_t load32(uint8_t const *src) {
+            uint32_t value;
+            memcpy(&value, src, sizeof(value));
+            return value;
+        }
+
+        uint32_t hash32(uint32_t value) {
+            return (value * 2654435761u) >> (32u - hashBits);
+        }
+
+        void writeLength(vector<uint8_t> &dst, Size length) {
+            for (; length >= 255; length -= 255) {
+                dst.push_back(255);
+            }
+            dst.push_back(uint8_t(length));
+        }
+
+        void writeSequence(vector<uint8_t> &dst, uint8_t const *literals, Size literalCount,
+                Size offset, Size matchLength) {
+            auto extraMatch = matchLength == 0 ? 0 : matchLength - minMatch;
+            dst.push_back(uint8_t(std::min(literalCount, lengthMask) << 4u | std::min(extraMatch, lengthMask)));
+            if (literalCount >= lengthMask) {
+                writeLength(dst, literalCount - lengthMask);
+            }
+            dst.insert(dst.end(), literals, literals + literalCount);
+
+            if (matchLength != 0) {
+                dst.push_back(uint8_t(offset));
+                dst.push_back(uint8_t(offset >> 8u));
+                if (extraMatch >= lengthMask) {
+                    writeLength(dst, extraMatch - lengthMask);
+                }
+            }
+        }
+
+        // sequences of literals followed by a back reference, the last one has literals only
+        void lzCompress(uint8_t const *src, Size size, vector<uint8_t> &dst) {
+            thread_local std::array<uint32_t, Size(1) << hashBits> table;
+            table.fill(0);
+
+            Size anchor = 0, position = 0;
+            while (position + minMatch <= size) {
+                auto sequence = load32(src + position);
+                auto &entry = table[hash32(sequence)];
+                Size candidate = entry;
+                entry = uint32_t(position);
+
+                if (candidate >= position || position - candidate > maxOffset
+                        || load32(src + candidate) != sequence) {
+                    ++position;
+                    continue;
+                }
+
+                auto length = minMatch;
+                while (position + length < size && src[candidate + length] == src[position + length]) {
+                    ++length;
+                }
+
+                writeSequence(dst, src + anchor, position - anchor, position - candidate, length);
+                position += length;
+                anchor = position;
+            }
+
+            writeSequence(dst, src + anchor, size - anchor, 0, 0);
+        }
+
+        void lzDecompress(uint8_t const *src, Size size, uint8_t *dst, Size capacity) {
+            auto fail = [] {
+                throw std::runtime_error("damaged compressed block");
+            };
+            auto readLength = [&](Size &in, Size length) {
+                if (length != lengthMask) {
+                    return length;
+                }
+                uint8_t next;
+                do {
+                    if (in == size) {
+                        fail();
+                    }
+                    next = src[in++];
+                    length += next;
+                } while (next == 255);
+                return length;
+            };
+
+            Size in = 0, out = 0;
+            while (in != size) {
+                auto token = src[in++];
+
+                auto literalCount = readLength(in, token >> 4u);
+                if (literalCount > size - in || literalCount > capacity - out) {
+                    fail();
+                }
+                std::copy_n(src + in, literalCount, dst + out);
+                in += literalCount;
+                out += literalCount;
+
+                if (in == size) {
+                    break;
+                }
+
+                if (size - in < 2) {
+                    fail();
+                }
+                Size offset = src[in] | Size(src[in + 1]) << 8u;
+                in += 2;
+                auto length = readLength(in, token & lengthMask) + minMatch;
+                if (offset == 0 || offset > out || length > capacity - out) {
+                    fail();
+                }
+
+                // overlapping matches repeat the last offset bytes, every copy doubles the repeated run
+                auto match = dst + out - offset;
+                for (Size copied = 0; copied != length;) {
+                    auto count = std::min(length - copied, copied + offset);
+                    memcpy(dst + out + copied, match, count);
+                    copied += count;
+                }
+                out += length;
+            }
+
+            if (out != capacity) {
+                fail();
+            }
+        }
+
+        // byte b of element i goes to lane b, every lane holds differences to the previous element
+        void transposeDelta(span<uint8_t const> src, Size stride, uint8_t *dst) {
+            auto count = src.size() / stride;
+            for (Size lane = 0; lane != stride; ++lane) {
+                uint8_t previous = 0;
+                auto laneDst = dst + lane * count;
+                for (Size i = 0; i != count; ++i) {
+                    auto value = src[i * stride + lane];
+                    laneDst[i] = uint8_t(value - previous);
+                    previous = value;
+                }
+            }
+            // bytes after the last whole element are kept as they are
+            std::copy(src.data() + count * stride, src.data() + src.size(), dst + count * stride);
+        }
+
+        void untransposeDelta(uint8_t const *src, Size stride, span<uint8_t> dst) {
+            auto count = dst.size() / stride;
+            for (Size lane = 0; lane != stride; ++lane) {
+                uint8_t value = 0;
+                auto laneSrc = src + lane * count;
+                auto laneDst = dst.data() + lane;
+                for (Size i = 0; i != count; ++i) {
+                    value = uint8_t(value + laneSrc[i]);
+                    laneDst[i * stride] = value;
+                }
+            }
+            auto tail = count * stride;
+            std::copy(src + tail, src + dst.size(), dst.data() + tail);
+        }
+
+        bool filtered(Size stride) {
+            return stride > 1 && stride <= 256;
+        }
+    }
+
+    Size compressBound(Size size) {
+        // one token and one length byte per 255 literals, plus a raw marker
+        return size + size / 255 + 16;
+    }
+
+    Size compressBlock(span<uint8_t const> src, Size stride, vector<uint8_t> &dst) {
+        auto start = dst.size();
+        dst.reserve(start + compressBound(src.size()));
+
+        dst.push_back(Plain);
+
+        auto data = src.data();
+        vector<uint8_t> transposed;
+        if (filtered(stride)) {
+            transposed.resize(src.size());
+            transposeDelta(src, stride, transposed.data());
+            data = transposed.data();
+            dst[start] = Filtered;
+        }
+
+        lzCompress(data, src.size(), dst);
+
+        // incompressible data is stored, decoding it is a plain copy
+        if (dst.size() - start - 1 >= src.size()) {
+            dst.resize(start);
+            dst.push_back(Stored);
+            dst.insert(dst.end(), src.begin(), src.end());
+        }
+
+        return dst.size() - start;
+    }
+
+    void decompressBlock(span<uint8_t const> src, Size stride, span<uint8_t> dst) {
+        if (src.empty()) {
+            throw std::runtime_error("damaged compressed block");
+        }
+
+        auto mode = src[0];
+        auto payload = src.subspan(1);
+        if (mode == Stored) {
+            if (payload.size() != dst.size()) {
+                throw std::runtime_error("damaged compressed block");
+            }
+            std::copy_n(payload.data(), payload.size(), dst.data());
+            return;
+        }
+
+        if (mode == Plain) {
+            lzDecompress(payload.data(), payload.size(), dst.data(), dst.size());
+            return;
+        }
+
+        if (mode != Filtered || !filtered(stride)) {
+            throw std::runtime_error("damaged compressed block");
+        }
+
+        thread_local vector<uint8_t> scratch;
+        scratch.resize(dst.size());
+        lzDecompress(payload.data(), payload.size(), scratch.data(), scratch.size());
+        untransposeDelta(scratch.data(), stride, dst);
+    }
+}
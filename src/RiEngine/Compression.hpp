@@ -0,0 +1,17 @@
+#pragma once
+
+namespace rise {
+    // Byte oriented LZ codec for vertex and index data. Blocks are independent, so a blob split
+    // into blocks decodes on any number of threads. With a stride above one the bytes of
+    // stride sized elements are regrouped by position in the element and delta coded first,
+    // which turns slowly changing attributes into long runs of small values.
+
+    // Largest compressed size of a size bytes block
+    Size compressBound(Size size);
+
+    // Appends the block to dst and returns its compressed size
+    Size compressBlock(span<uint8_t const> src, Size stride, vector<uint8_t> &dst);
+
+    // dst must be exactly the size the block was compressed from, throws on damaged blocks
+    void decompressBlock(span<uint8_t const> src, Size stride, span<uint8_t> dst);
+}
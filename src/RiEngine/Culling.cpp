@@ -0,0 +1,171 @@
+#include "Culling.hpp"
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace rise {
+    namespace {
+        struct SphereBatch {
+            vector<float> x, y, z, radius;
+
+            void resize(Size count) {
+                x.resize(count);
+                y.resize(count);
+                z.resize(count);
+                radius.resize(count);
+            }
+        };
+
+        // reused between calls, culling runs every frame
+        thread_local SphereBatch batch;
+
+        glm::vec4 row(glm::mat4 const &m, int i) {
+            return {m[0][i], m[1][i], m[2][i], m[3][i]};
+        }
+
+        glm::vec4 normalizePlane(glm::vec4 const &plane) {
+            auto length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            return length > 0.f ? plane * (1.f / length) : plane;
+        }
+
+        bool sphereVisible(Frustum const &frustum, float x, float y, float z, float radius) {
+            for (auto const &plane : frustum.planes) {
+                if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void cullBatch(Frustum const &frustum, SphereBatch const &spheres, Size count, vector<uint32_t> &visible) {
+            Size i = 0;
+
+#if defined(__AVX__)
+            for (; i + 8 <= count; i += 8) {
+                auto x = _mm256_loadu_ps(&spheres.x[i]);
+                auto y = _mm256_loadu_ps(&spheres.y[i]);
+                auto z = _mm256_loadu_ps(&spheres.z[i]);
+                auto negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+                auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (auto const &plane : frustum.planes) {
+                    auto distance = _mm256_add_ps(
+                            _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+                            _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+                }
+
+                for (auto mask = unsigned(_mm256_movemask_ps(inside)); mask != 0; mask &= mask - 1) {
+                    visible.push_back(uint32_t(i + std::countr_zero(mask)));
+                }
+            }
+#elif defined(__SSE2__) || defined(_M_X64)
+            for (; i + 4 <= count; i += 4) {
+                auto x = _mm_loadu_ps(&spheres.x[i]);
+                auto y = _mm_loadu_ps(&spheres.y[i]);
+                auto z = _mm_loadu_ps(&spheres.z[i]);
+                auto negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+                auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (auto const &plane : frustum.planes) {
+                    auto distance = _mm_add_ps(
+                            _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                            _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+                }
+
+                for (auto mask = unsigned(_mm_movemask_ps(inside)); mask != 0; mask &= mask - 1) {
+                    visible.push_back(uint32_t(i + std::countr_zero(mask)));
+                }
+            }
+#endif
+
+            for (; i != count; ++i) {
+                if (sphereVisible(frustum, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) {
+                    visible.push_back(uint32_t(i));
+                }
+            }
+        }
+    }
+
+    Bounds Bounds::infinite() {
+        auto infinity = std::numeric_limits<float>::infinity();
+        return {glm::vec3(-infinity), glm::vec3(infinity), glm::vec3(0.f), infinity};
+    }
+
+    Bounds computeBounds(span<glm::vec3 const> positions) {
+        if (positions.empty()) {
+            return Bounds::infinite();
+        }
+
+        Bounds bounds = {positions[0], positions[0], glm::vec3(0.f), 0.f};
+        for (auto const &p : positions) {
+            bounds.min = glm::min(bounds.min, p);
+            bounds.max = glm::max(bounds.max, p);
+        }
+
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        for (auto const &p : positions) {
+            bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, p));
+        }
+        return bounds;
+    }
+
+    Frustum Frustum::fromMatrix(glm::mat4 const &viewProjection, bool zeroToOneDepth) {
+        auto x = row(viewProjection, 0), y = row(viewProjection, 1);
+        auto z = row(viewProjection, 2), w = row(viewProjection, 3);
+
+        Frustum frustum = {};
+        frustum.planes = {
+                normalizePlane(w + x),
+                normalizePlane(w - x),
+                normalizePlane(w + y),
+                normalizePlane(w - y),
+                normalizePlane(zeroToOneDepth ? z : w + z),
+                normalizePlane(w - z),
+        };
+        return frustum;
+    }
+
+    void cullSpheres(Frustum const &frustum, span<glm::vec4 const> spheres, vector<uint32_t> &visible) {
+        batch.resize(spheres.size());
+        for (Size i = 0; i != spheres.size(); ++i) {
+            batch.x[i] = spheres[i].x;
+            batch.y[i] = spheres[i].y;
+            batch.z[i] = spheres[i].z;
+            batch.radius[i] = spheres[i].w;
+        }
+        cullBatch(frustum, batch, spheres.size(), visible);
+    }
+
+    bool coneBackfacing(glm::vec3 center, float radius, glm::vec3 coneAxis, float coneCutoff,
+            glm::vec3 cameraPosition) {
+        auto toCenter = center - cameraPosition;
+        return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+    }
+
+    void cullInstances(Frustum const &frustum, Bounds const &bounds, span<glm::mat4 const> transforms,
+            vector<uint32_t> &visible) {
+        batch.resize(transforms.size());
+        glm::vec4 center(bounds.center, 1.f);
+        for (Size i = 0; i != transforms.size(); ++i) {
+            auto const &m = transforms[i];
+            auto moved = m * center;
+
+            auto axisScale = [&m](int axis) {
+                glm::vec3 column(m[axis]);
+                return glm::dot(column, column);
+            };
+            auto scale = std::max({axisScale(0), axisScale(1), axisScale(2)});
+
+            batch.x[i] = moved.x;
+            batch.y[i] = moved.y;
+            batch.z[i] = moved.z;
+            // infinite bounds stay visible, scaled by a collapsed axis they would become NaN
+            batch.radius[i] = std::isfinite(bounds.radius) ? bounds.radius * std::sqrt(scale)
+                    : std::numeric_limits<float>::infinity();
+        }
+        cullBatch(frustum, batch, transforms.size(), visible);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace rise {
+    // Axis aligned box and a sphere around its center enclosing every point
+    struct Bounds {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::vec3 center;
+        float radius;
+
+        // never culled, used for meshes without positions
+        static Bounds infinite();
+    };
+
+    Bounds computeBounds(span<glm::vec3 const> positions);
+
+    // Planes point inwards, p is inside when dot(plane.xyz, p) + plane.w >= 0 for every plane
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+
+        // OpenGL clip space depth by default, zeroToOneDepth for Vulkan or glClipControl
+        static Frustum fromMatrix(glm::mat4 const &viewProjection, bool zeroToOneDepth = false);
+    };
+
+    // Appends positions of spheres, xyz center and w radius, that intersect the frustum. Tested in
+    // structure of arrays batches of 8 with AVX or 4 with SSE, scalar otherwise.
+    void cullSpheres(Frustum const &frustum, span<glm::vec4 const> spheres, vector<uint32_t> &visible);
+
+    // True when every triangle of a meshlet faces away from the camera, a meshlet seen from any front
+    // side is never reported. The apex of the normal cone is unknown, so the test is widened by the
+    // bounding sphere: dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius
+    bool coneBackfacing(glm::vec3 center, float radius, glm::vec3 coneAxis, float coneCutoff,
+            glm::vec3 cameraPosition);
+
+    // Appends positions of visible instances of a mesh, the bounding sphere is moved by every
+    // transform and scaled by its largest axis scale
+    void cullInstances(Frustum const &frustum, Bounds const &bounds, span<glm::mat4 const> transforms,
+            vector<uint32_t> &visible);
+}
@@ -106,5 +106,265 @@ namespace rise {
         D32SfloatS8Uint,
     };
 
-    Size formatSize(Format format);
-}
\ No newline at end of file
+    enum class NumericClass {
+        None,
+        Unorm,
+        Snorm,
+        Uscaled,
+        Sscaled,
+        Uint,
+        Sint,
+        Sfloat,
+        Srgb,
+    };
+
+    struct FormatInfo {
+        Format format = Format::Undefined;
+        Size size = 0;
+        Size components = 0;
+        std::array<uint8_t, 4> bits = {};
+        // depth/stencil formats describe the depth component, stencil is always 8 bit uint
+        NumericClass numeric = NumericClass::None;
+        bool depth = false;
+        bool stencil = false;
+        bool srgb = false;
+        bool bgr = false;
+    };
+
+    constexpr Size formatCount = Size(Format::D32SfloatS8Uint) + 1;
+
+    constexpr std::array<FormatInfo, formatCount> formatInfos = {{
+            {.format = Format::Undefined},
+            {.format = Format::R8Unorm, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Unorm},
+            {.format = Format::R8Snorm, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Snorm},
+            {.format = Format::R8Uscaled, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R8Sscaled, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R8Uint, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Uint},
+            {.format = Format::R8Sint, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Sint},
+            {.format = Format::R8Srgb, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Srgb, .srgb = true},
+            {.format = Format::R8G8Unorm, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Unorm},
+            {.format = Format::R8G8Snorm, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Snorm},
+            {.format = Format::R8G8Uscaled, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R8G8Sscaled, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R8G8Uint, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Uint},
+            {.format = Format::R8G8Sint, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Sint},
+            {.format = Format::R8G8Srgb, .size = 2, .components = 2,
+                    .bits = {8, 8}, .numeric = NumericClass::Srgb, .srgb = true},
+            {.format = Format::R8G8B8Unorm, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Unorm},
+            {.format = Format::R8G8B8Snorm, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Snorm},
+            {.format = Format::R8G8B8Uscaled, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R8G8B8Sscaled, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R8G8B8Uint, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Uint},
+            {.format = Format::R8G8B8Sint, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Sint},
+            {.format = Format::R8G8B8Srgb, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Srgb, .srgb = true},
+            {.format = Format::B8G8R8Unorm, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Unorm, .bgr = true},
+            {.format = Format::B8G8R8Snorm, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Snorm, .bgr = true},
+            {.format = Format::B8G8R8Uscaled, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Uscaled, .bgr = true},
+            {.format = Format::B8G8R8Sscaled, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Sscaled, .bgr = true},
+            {.format = Format::B8G8R8Uint, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Uint, .bgr = true},
+            {.format = Format::B8G8R8Sint, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Sint, .bgr = true},
+            {.format = Format::B8G8R8Srgb, .size = 3, .components = 3,
+                    .bits = {8, 8, 8}, .numeric = NumericClass::Srgb, .srgb = true, .bgr = true},
+            {.format = Format::R8G8B8A8Unorm, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Unorm},
+            {.format = Format::R8G8B8A8Snorm, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Snorm},
+            {.format = Format::R8G8B8A8Uscaled, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R8G8B8A8Sscaled, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R8G8B8A8Uint, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Uint},
+            {.format = Format::R8G8B8A8Sint, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Sint},
+            {.format = Format::R8G8B8A8Srgb, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Srgb, .srgb = true},
+            {.format = Format::B8G8R8A8Unorm, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Unorm, .bgr = true},
+            {.format = Format::B8G8R8A8Snorm, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Snorm, .bgr = true},
+            {.format = Format::B8G8R8A8Uscaled, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Uscaled, .bgr = true},
+            {.format = Format::B8G8R8A8Sscaled, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Sscaled, .bgr = true},
+            {.format = Format::B8G8R8A8Uint, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Uint, .bgr = true},
+            {.format = Format::B8G8R8A8Sint, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Sint, .bgr = true},
+            {.format = Format::B8G8R8A8Srgb, .size = 4, .components = 4,
+                    .bits = {8, 8, 8, 8}, .numeric = NumericClass::Srgb, .srgb = true, .bgr = true},
+            {.format = Format::R16Unorm, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Unorm},
+            {.format = Format::R16Snorm, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Snorm},
+            {.format = Format::R16Uscaled, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R16Sscaled, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R16Uint, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Uint},
+            {.format = Format::R16Sint, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Sint},
+            {.format = Format::R16Sfloat, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R16G16Unorm, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Unorm},
+            {.format = Format::R16G16Snorm, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Snorm},
+            {.format = Format::R16G16Uscaled, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R16G16Sscaled, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R16G16Uint, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Uint},
+            {.format = Format::R16G16Sint, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Sint},
+            {.format = Format::R16G16Sfloat, .size = 4, .components = 2,
+                    .bits = {16, 16}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R16G16B16Unorm, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Unorm},
+            {.format = Format::R16G16B16Snorm, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Snorm},
+            {.format = Format::R16G16B16Uscaled, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R16G16B16Sscaled, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R16G16B16Uint, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Uint},
+            {.format = Format::R16G16B16Sint, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Sint},
+            {.format = Format::R16G16B16Sfloat, .size = 6, .components = 3,
+                    .bits = {16, 16, 16}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R16G16B16A16Unorm, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Unorm},
+            {.format = Format::R16G16B16A16Snorm, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Snorm},
+            {.format = Format::R16G16B16A16Uscaled, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Uscaled},
+            {.format = Format::R16G16B16A16Sscaled, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Sscaled},
+            {.format = Format::R16G16B16A16Uint, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Uint},
+            {.format = Format::R16G16B16A16Sint, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Sint},
+            {.format = Format::R16G16B16A16Sfloat, .size = 8, .components = 4,
+                    .bits = {16, 16, 16, 16}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R32Uint, .size = 4, .components = 1,
+                    .bits = {32}, .numeric = NumericClass::Uint},
+            {.format = Format::R32Sint, .size = 4, .components = 1,
+                    .bits = {32}, .numeric = NumericClass::Sint},
+            {.format = Format::R32Sfloat, .size = 4, .components = 1,
+                    .bits = {32}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R32G32Uint, .size = 8, .components = 2,
+                    .bits = {32, 32}, .numeric = NumericClass::Uint},
+            {.format = Format::R32G32Sint, .size = 8, .components = 2,
+                    .bits = {32, 32}, .numeric = NumericClass::Sint},
+            {.format = Format::R32G32Sfloat, .size = 8, .components = 2,
+                    .bits = {32, 32}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R32G32B32Uint, .size = 12, .components = 3,
+                    .bits = {32, 32, 32}, .numeric = NumericClass::Uint},
+            {.format = Format::R32G32B32Sint, .size = 12, .components = 3,
+                    .bits = {32, 32, 32}, .numeric = NumericClass::Sint},
+            {.format = Format::R32G32B32Sfloat, .size = 12, .components = 3,
+                    .bits = {32, 32, 32}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R32G32B32A32Uint, .size = 16, .components = 4,
+                    .bits = {32, 32, 32, 32}, .numeric = NumericClass::Uint},
+            {.format = Format::R32G32B32A32Sint, .size = 16, .components = 4,
+                    .bits = {32, 32, 32, 32}, .numeric = NumericClass::Sint},
+            {.format = Format::R32G32B32A32Sfloat, .size = 16, .components = 4,
+                    .bits = {32, 32, 32, 32}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R64Uint, .size = 8, .components = 1,
+                    .bits = {64}, .numeric = NumericClass::Uint},
+            {.format = Format::R64Sint, .size = 8, .components = 1,
+                    .bits = {64}, .numeric = NumericClass::Sint},
+            {.format = Format::R64Sfloat, .size = 8, .components = 1,
+                    .bits = {64}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R64G64Uint, .size = 16, .components = 2,
+                    .bits = {64, 64}, .numeric = NumericClass::Uint},
+            {.format = Format::R64G64Sint, .size = 16, .components = 2,
+                    .bits = {64, 64}, .numeric = NumericClass::Sint},
+            {.format = Format::R64G64Sfloat, .size = 16, .components = 2,
+                    .bits = {64, 64}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R64G64B64Uint, .size = 24, .components = 3,
+                    .bits = {64, 64, 64}, .numeric = NumericClass::Uint},
+            {.format = Format::R64G64B64Sint, .size = 24, .components = 3,
+                    .bits = {64, 64, 64}, .numeric = NumericClass::Sint},
+            {.format = Format::R64G64B64Sfloat, .size = 24, .components = 3,
+                    .bits = {64, 64, 64}, .numeric = NumericClass::Sfloat},
+            {.format = Format::R64G64B64A64Uint, .size = 32, .components = 4,
+                    .bits = {64, 64, 64, 64}, .numeric = NumericClass::Uint},
+            {.format = Format::R64G64B64A64Sint, .size = 32, .components = 4,
+                    .bits = {64, 64, 64, 64}, .numeric = NumericClass::Sint},
+            {.format = Format::R64G64B64A64Sfloat, .size = 32, .components = 4,
+                    .bits = {64, 64, 64, 64}, .numeric = NumericClass::Sfloat},
+            {.format = Format::D16Unorm, .size = 2, .components = 1,
+                    .bits = {16}, .numeric = NumericClass::Unorm, .depth = true},
+            {.format = Format::D32Sfloat, .size = 4, .components = 1,
+                    .bits = {32}, .numeric = NumericClass::Sfloat, .depth = true},
+            {.format = Format::S8Uint, .size = 1, .components = 1,
+                    .bits = {8}, .numeric = NumericClass::Uint, .stencil = true},
+            {.format = Format::D16UnormS8Uint, .size = 3, .components = 2,
+                    .bits = {16, 8}, .numeric = NumericClass::Unorm, .depth = true, .stencil = true},
+            {.format = Format::D24UnormS8Uint, .size = 4, .components = 2,
+                    .bits = {24, 8}, .numeric = NumericClass::Unorm, .depth = true, .stencil = true},
+            {.format = Format::D32SfloatS8Uint, .size = 5, .components = 2,
+                    .bits = {32, 8}, .numeric = NumericClass::Sfloat, .depth = true, .stencil = true},
+    }};
+
+    constexpr FormatInfo const &formatInfo(Format format) {
+        return formatInfos[Size(format)];
+    }
+
+    constexpr Size formatSize(Format format) {
+        return formatInfo(format).size;
+    }
+
+    constexpr Size vertexSize(std::initializer_list<Format> attributes) {
+        Size size = 0;
+        for (auto format : attributes) {
+            size += formatSize(format);
+        }
+        return size;
+    }
+
+    namespace util {
+        constexpr bool formatTableOrdered() {
+            for (Size i = 0; i != formatCount; ++i) {
+                if (formatInfos[i].format != Format(i)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    static_assert(util::formatTableOrdered(), "formatInfos must follow Format order");
+    static_assert(formatSize(Format::R16G16B16A16Snorm) == 8);
+    static_assert(vertexSize({Format::R32G32B32Sfloat, Format::R32G32B32Sfloat, Format::R32G32Sfloat}) == 32);
+}
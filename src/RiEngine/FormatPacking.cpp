@@ -0,0 +1,400 @@
+#include "FormatPacking.hpp"
+#include <glm/gtc/packing.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace rise {
+    namespace {
+        float linearToSrgb(float value) {
+            value = std::clamp(value, 0.f, 1.f);
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        }
+
+        float srgbToLinear(float value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        template<typename T>
+        T roundClamped(double value) {
+            constexpr auto lowest = std::numeric_limits<T>::lowest();
+            constexpr auto highest = std::numeric_limits<T>::max();
+
+            if (!(value > double(lowest))) {
+                return lowest;
+            }
+            if (value >= double(highest)) {
+                return highest;
+            }
+            return T(value >= 0 ? value + 0.5 : value - 0.5);
+        }
+
+        template<typename T, NumericClass numeric>
+        T encodeComponent(float value, Size component) {
+            constexpr auto highest = float(std::numeric_limits<T>::max());
+
+            if constexpr (numeric == NumericClass::Unorm) {
+                return roundClamped<T>(std::clamp(value, 0.f, 1.f) * highest);
+            } else if constexpr (numeric == NumericClass::Snorm) {
+                return roundClamped<T>(std::clamp(value, -1.f, 1.f) * highest);
+            } else if constexpr (numeric == NumericClass::Srgb) {
+                auto linear = component == 3 ? std::clamp(value, 0.f, 1.f) : linearToSrgb(value);
+                return roundClamped<T>(linear * highest);
+            } else if constexpr (numeric == NumericClass::Sfloat) {
+                if constexpr (std::is_same_v<T, uint16_t>) {
+                    return glm::packHalf1x16(value);
+                } else {
+                    return T(value);
+                }
+            } else {
+                return roundClamped<T>(value);
+            }
+        }
+
+        template<typename T, NumericClass numeric>
+        float decodeComponent(T value, Size component) {
+            constexpr auto highest = float(std::numeric_limits<T>::max());
+
+            if constexpr (numeric == NumericClass::Unorm) {
+                return float(value) / highest;
+            } else if constexpr (numeric == NumericClass::Snorm) {
+                return std::max(float(value) / highest, -1.f);
+            } else if constexpr (numeric == NumericClass::Srgb) {
+                return component == 3 ? float(value) / highest : srgbToLinear(float(value) / highest);
+            } else if constexpr (numeric == NumericClass::Sfloat && std::is_same_v<T, uint16_t>) {
+                return glm::unpackHalf1x16(value);
+            } else {
+                return float(value);
+            }
+        }
+
+        template<Size srcComponents>
+        float fetch(float const *src, Size component) {
+            if (component < srcComponents) {
+                return src[component];
+            }
+            return component == 3 ? 1.f : 0.f;
+        }
+
+#if defined(__SSE2__) || defined(_M_X64)
+        // Batch path packing one element per register, bgr formats swizzle the register first. 32 bit
+        // floats are already plain moves.
+        template<typename T, NumericClass numeric>
+        constexpr bool packedInRegister = sizeof(T) <= sizeof(uint16_t) && (numeric == NumericClass::Sfloat
+                || numeric == NumericClass::Unorm || numeric == NumericClass::Snorm);
+
+        // missing components are filled like fetch does, never reads past the element
+        template<Size srcComponents>
+        __m128 load(float const *src) {
+            if constexpr (srcComponents == 1) {
+                return _mm_set_ps(1.f, 0.f, 0.f, src[0]);
+            } else if constexpr (srcComponents == 4) {
+                return _mm_loadu_ps(src);
+            } else {
+                auto xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<double const *>(src)));
+                if constexpr (srcComponents == 2) {
+                    return _mm_movelh_ps(xy, _mm_set_ps(0.f, 0.f, 1.f, 0.f));
+                } else {
+                    return _mm_movelh_ps(xy, _mm_unpacklo_ps(_mm_load_ss(src + 2), _mm_set_ss(1.f)));
+                }
+            }
+        }
+
+        // packed elements are at most four 16 bit components
+        template<Size size>
+        void store(__m128i packed, uint8_t *dst) {
+            if constexpr (size == 8) {
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), packed);
+            } else if constexpr (size == 4) {
+                auto word = _mm_cvtsi128_si32(packed);
+                memcpy(dst, &word, size);
+            } else {
+                alignas(16) uint8_t bytes[16];
+                _mm_store_si128(reinterpret_cast<__m128i *>(bytes), packed);
+                memcpy(dst, bytes, size);
+            }
+        }
+
+        // rounds half away from zero as roundClamped does, compare masks are -1
+        __m128i roundAway(__m128 value) {
+            auto truncated = _mm_cvttps_epi32(value);
+            auto fraction = _mm_sub_ps(value, _mm_cvtepi32_ps(truncated));
+            truncated = _mm_sub_epi32(truncated, _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+            return _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmple_ps(fraction, _mm_set1_ps(-0.5f))));
+        }
+
+        template<typename T, NumericClass numeric>
+        __m128i normalized(__m128 value) {
+            constexpr auto highest = float(std::numeric_limits<T>::max());
+            constexpr auto lowest = int32_t(std::numeric_limits<T>::lowest());
+            constexpr auto low = numeric == NumericClass::Snorm ? -1.f : 0.f;
+
+            // NaN packs to the lowest value like in roundClamped
+            auto nan = _mm_castps_si128(_mm_cmpunord_ps(value, value));
+            value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(low)), _mm_set1_ps(1.f));
+            auto rounded = roundAway(_mm_mul_ps(value, _mm_set1_ps(highest)));
+            return _mm_or_si128(_mm_andnot_si128(nan, rounded), _mm_and_si128(nan, _mm_set1_epi32(lowest)));
+        }
+
+        // Half rounding of glm::packHalf1x16 for normal halves and values flushed to zero. False when
+        // a component is a half denormal, overflows or is NaN, those take the scalar path.
+        bool half(__m128 value, __m128i &packed) {
+            auto bits = _mm_castps_si128(value);
+            auto magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+
+            // biased float exponents below 102 round to zero, 113 to 142 are normal halves
+            auto zero = _mm_cmplt_epi32(magnitude, _mm_set1_epi32(102 << 23));
+            auto normal = _mm_andnot_si128(_mm_cmplt_epi32(magnitude, _mm_set1_epi32(113 << 23)),
+                    _mm_cmplt_epi32(magnitude, _mm_set1_epi32(143 << 23)));
+            if (_mm_movemask_epi8(_mm_or_si128(zero, normal)) != 0xFFFF) {
+                return false;
+            }
+
+            // rebias the exponent and round on the highest dropped bit, a carry moves into the exponent
+            auto rebiased = _mm_add_epi32(_mm_sub_epi32(magnitude, _mm_set1_epi32(112 << 23)), _mm_set1_epi32(0x1000));
+            auto halfMagnitude = _mm_and_si128(_mm_srli_epi32(rebiased, 13), normal);
+            auto sign = _mm_srai_epi32(bits, 16);
+            packed = _mm_or_si128(_mm_packs_epi32(halfMagnitude, halfMagnitude),
+                    _mm_and_si128(_mm_packs_epi32(sign, sign), _mm_set1_epi16(int16_t(0x8000))));
+            return true;
+        }
+
+        template<typename T, NumericClass numeric>
+        bool pack(__m128 value, __m128i &packed) {
+            if constexpr (numeric == NumericClass::Sfloat) {
+                return half(value, packed);
+            } else if constexpr (std::is_same_v<T, uint16_t>) {
+                // SSE2 only narrows with signed saturation, shift into the signed range and back
+                packed = _mm_sub_epi32(normalized<T, numeric>(value), _mm_set1_epi32(0x8000));
+                packed = _mm_xor_si128(_mm_packs_epi32(packed, packed), _mm_set1_epi16(int16_t(0x8000)));
+            } else {
+                packed = normalized<T, numeric>(value);
+                packed = _mm_packs_epi32(packed, packed);
+                if constexpr (sizeof(T) == 1) {
+                    packed = std::is_signed_v<T> ? _mm_packs_epi16(packed, packed) : _mm_packus_epi16(packed, packed);
+                }
+            }
+            return true;
+        }
+#endif
+
+        // Plain formats: every component is one T, bgr formats keep red and blue swapped in memory
+        template<typename T, NumericClass numeric, Size components, bool bgr = false>
+        struct Packer {
+            static constexpr Size size = sizeof(T) * components;
+
+            static constexpr Size source(Size component) {
+                return bgr && component < 3 ? 2 - component : component;
+            }
+
+            template<Size srcComponents>
+            static void encode(float const *src, Size count, uint8_t *dst, Size dstStride) {
+                if constexpr (std::is_same_v<T, float> && components <= srcComponents && !bgr) {
+                    if (components == srcComponents && dstStride == size) {
+                        memcpy(dst, src, count * size);
+                        return;
+                    }
+                    // interleaved copies, source components past the format are dropped
+                    for (Size i = 0; i != count; ++i, src += srcComponents, dst += dstStride) {
+                        memcpy(dst, src, size);
+                    }
+                    return;
+                }
+
+#if defined(__SSE2__) || defined(_M_X64)
+                if constexpr (packedInRegister<T, numeric>) {
+                    for (Size i = 0; i != count; ++i, src += srcComponents, dst += dstStride) {
+                        auto value = load<srcComponents>(src);
+                        if constexpr (bgr) {
+                            value = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 1, 2));
+                        }
+
+                        __m128i packed;
+                        if (pack<T, numeric>(value, packed)) {
+                            store<size>(packed, dst);
+                        } else {
+                            encodeElement<srcComponents>(src, dst);
+                        }
+                    }
+                    return;
+                }
+#endif
+
+                for (Size i = 0; i != count; ++i, src += srcComponents, dst += dstStride) {
+                    encodeElement<srcComponents>(src, dst);
+                }
+            }
+
+            template<Size srcComponents>
+            static void encodeElement(float const *src, uint8_t *dst) {
+                T packed[components];
+                for (Size c = 0; c != components; ++c) {
+                    packed[c] = encodeComponent<T, numeric>(fetch<srcComponents>(src, source(c)), source(c));
+                }
+                memcpy(dst, packed, size);
+            }
+
+            static void decode(uint8_t const *src, Size srcStride, Size count, glm::vec4 *dst) {
+                for (Size i = 0; i != count; ++i, src += srcStride) {
+                    T packed[components];
+                    memcpy(packed, src, size);
+
+                    glm::vec4 value(0.f, 0.f, 0.f, 1.f);
+                    for (Size c = 0; c != components; ++c) {
+                        value[source(c)] = decodeComponent<T, numeric>(packed[c], source(c));
+                    }
+                    dst[i] = value;
+                }
+            }
+        };
+
+        // Depth in the first component followed by an 8 bit stencil
+        template<typename Depth, NumericClass numeric>
+        struct DepthStencilPacker {
+            static constexpr Size size = sizeof(Depth) + sizeof(uint8_t);
+
+            template<Size srcComponents>
+            static void encode(float const *src, Size count, uint8_t *dst, Size dstStride) {
+                for (Size i = 0; i != count; ++i, src += srcComponents, dst += dstStride) {
+                    auto depth = encodeComponent<Depth, numeric>(fetch<srcComponents>(src, 0), 0);
+                    auto stencil = encodeComponent<uint8_t, NumericClass::Uint>(fetch<srcComponents>(src, 1), 1);
+                    memcpy(dst, &depth, sizeof(Depth));
+                    memcpy(dst + sizeof(Depth), &stencil, sizeof(uint8_t));
+                }
+            }
+
+            static void decode(uint8_t const *src, Size srcStride, Size count, glm::vec4 *dst) {
+                for (Size i = 0; i != count; ++i, src += srcStride) {
+                    Depth depth;
+                    memcpy(&depth, src, sizeof(Depth));
+                    dst[i] = glm::vec4(decodeComponent<Depth, numeric>(depth, 0), float(src[sizeof(Depth)]), 0.f, 1.f);
+                }
+            }
+        };
+
+        // 24 bit normalized depth in the low bits and stencil in the high byte of one word
+        struct D24S8Packer {
+            static constexpr Size size = sizeof(uint32_t);
+            static constexpr float depthMax = float((1u << 24u) - 1u);
+
+            template<Size srcComponents>
+            static void encode(float const *src, Size count, uint8_t *dst, Size dstStride) {
+                for (Size i = 0; i != count; ++i, src += srcComponents, dst += dstStride) {
+                    auto depth = uint32_t(std::clamp(fetch<srcComponents>(src, 0), 0.f, 1.f) * depthMax + 0.5f);
+                    auto stencil = uint32_t(encodeComponent<uint8_t, NumericClass::Uint>(fetch<srcComponents>(src, 1), 1));
+                    auto packed = depth | stencil << 24u;
+                    memcpy(dst, &packed, size);
+                }
+            }
+
+            static void decode(uint8_t const *src, Size srcStride, Size count, glm::vec4 *dst) {
+                for (Size i = 0; i != count; ++i, src += srcStride) {
+                    uint32_t packed;
+                    memcpy(&packed, src, size);
+                    dst[i] = glm::vec4(float(packed & 0xFFFFFFu) / depthMax, float(packed >> 24u), 0.f, 1.f);
+                }
+            }
+        };
+
+        template<Size bits, NumericClass numeric>
+        auto componentType() {
+            constexpr bool isFloat = numeric == NumericClass::Sfloat;
+            constexpr bool isSigned = numeric == NumericClass::Snorm || numeric == NumericClass::Sscaled
+                    || numeric == NumericClass::Sint;
+
+            if constexpr (bits == 8) {
+                return std::conditional_t<isSigned, int8_t, uint8_t>();
+            } else if constexpr (bits == 16) {
+                // half floats are kept as raw bits
+                return std::conditional_t<isSigned, int16_t, uint16_t>();
+            } else if constexpr (bits == 32) {
+                return std::conditional_t<isFloat, float, std::conditional_t<isSigned, int32_t, uint32_t>>();
+            } else {
+                return std::conditional_t<isFloat, double, std::conditional_t<isSigned, int64_t, uint64_t>>();
+            }
+        }
+
+        template<Format format>
+        auto selectPacker() {
+            constexpr auto info = formatInfo(format);
+            using Component = decltype(componentType<info.bits[0], info.numeric>());
+
+            if constexpr (info.depth && info.stencil && info.bits[0] == 24) {
+                return std::type_identity<D24S8Packer>();
+            } else if constexpr (info.depth && info.stencil) {
+                return std::type_identity<DepthStencilPacker<Component, info.numeric>>();
+            } else {
+                return std::type_identity<Packer<Component, info.numeric, info.components, info.bgr>>();
+            }
+        }
+
+        template<Format format>
+        using PackerFor = typename decltype(selectPacker<format>())::type;
+
+        using EncodeKernels = std::array<EncodeKernel, 4>;
+
+        template<Format format>
+        constexpr EncodeKernels encodeKernelsFor() {
+            if constexpr (format == Format::Undefined) {
+                return {};
+            } else {
+                using P = PackerFor<format>;
+                return {&P::template encode<1>, &P::template encode<2>, &P::template encode<3>,
+                        &P::template encode<4>};
+            }
+        }
+
+        template<Format format>
+        constexpr DecodeKernel decodeKernelFor() {
+            if constexpr (format == Format::Undefined) {
+                return nullptr;
+            } else {
+                return &PackerFor<format>::decode;
+            }
+        }
+
+        template<Size... formats>
+        constexpr auto makeEncodeKernels(std::index_sequence<formats...>) {
+            return std::array<EncodeKernels, formatCount>{encodeKernelsFor<Format(formats)>()...};
+        }
+
+        template<Size... formats>
+        constexpr auto makeDecodeKernels(std::index_sequence<formats...>) {
+            return std::array<DecodeKernel, formatCount>{decodeKernelFor<Format(formats)>()...};
+        }
+
+        constexpr auto encodeKernels = makeEncodeKernels(std::make_index_sequence<formatCount>());
+        constexpr auto decodeKernels = makeDecodeKernels(std::make_index_sequence<formatCount>());
+    }
+
+    EncodeKernel encodeKernel(Format format, Size srcComponents) {
+        if (srcComponents < 1 || srcComponents > 4) {
+            throw std::runtime_error("source must have 1 to 4 components");
+        }
+
+        auto kernel = encodeKernels[Size(format)][srcComponents - 1];
+        if (!kernel) {
+            throw std::runtime_error("not implemented format!");
+        }
+        return kernel;
+    }
+
+    DecodeKernel decodeKernel(Format format) {
+        auto kernel = decodeKernels[Size(format)];
+        if (!kernel) {
+            throw std::runtime_error("not implemented format!");
+        }
+        return kernel;
+    }
+
+    void encode(Format format, glm::vec4 const &value, uint8_t *dst) {
+        encodeKernel(format, 4)(&value.x, 1, dst, 0);
+    }
+
+    glm::vec4 decode(Format format, uint8_t const *src) {
+        glm::vec4 value;
+        decodeKernel(format)(src, 0, 1, &value);
+        return value;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Format.hpp"
+#include <glm/glm.hpp>
+
+namespace rise {
+    // Writes count elements with dstStride bytes between them. Kernels are specialized on the number
+    // of floats per source element, missing components are taken as (0, 0, 0, 1) as vertex fetch does.
+    // With SSE2, normalized and half formats of 8 and 16 bit components pack an element per register.
+    using EncodeKernel = void (*)(float const *src, Size count, uint8_t *dst, Size dstStride);
+
+    using DecodeKernel = void (*)(uint8_t const *src, Size srcStride, Size count, glm::vec4 *dst);
+
+    EncodeKernel encodeKernel(Format format, Size srcComponents);
+
+    DecodeKernel decodeKernel(Format format);
+
+    void encode(Format format, glm::vec4 const &value, uint8_t *dst);
+
+    glm::vec4 decode(Format format, uint8_t const *src);
+}
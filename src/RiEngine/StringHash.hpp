@@ -0,0 +1,15 @@
+#pragma once
+
+namespace rise {
+    // Transparent hash, string keyed tables can be searched with a string_view without building a string
+    struct StringHash {
+        using is_transparent = void;
+
+        Size operator()(string_view value) const {
+            return std::hash<string_view>()(value);
+        }
+    };
+
+    template<typename T>
+    using StringMap = std::unordered_map<string, T, StringHash, std::equal_to<>>;
+}
@@ -0,0 +1,96 @@
+#include "ThreadPool.hpp"
+
+namespace rise {
+    namespace {
+        thread_local ThreadPool const *currentPool = nullptr;
+        thread_local Size currentQueue = 0;
+    }
+
+    ThreadPool::ThreadPool(Size threadCount) {
+        threadCount = std::max(threadCount, Size(1));
+
+        mQueues.reserve(threadCount);
+        for (Size i = 0; i != threadCount; ++i) {
+            mQueues.push_back(std::make_unique<Queue>());
+        }
+
+        mWorkers.reserve(threadCount);
+        for (Size i = 0; i != threadCount; ++i) {
+            mWorkers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mSleepMutex);
+            mStop = true;
+        }
+        mWakeUp.notify_all();
+
+        for (auto &worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::submit(Task task) {
+        auto index = currentPool == this ? currentQueue
+                : mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+
+        {
+            std::lock_guard lock(mSleepMutex);
+            ++mPending;
+        }
+
+        {
+            std::lock_guard lock(mQueues[index]->mutex);
+            mQueues[index]->tasks.push_back(std::move(task));
+        }
+        mWakeUp.notify_one();
+    }
+
+    bool ThreadPool::runPending() {
+        auto own = currentPool == this ? currentQueue : 0;
+
+        Task task;
+        for (Size i = 0; i != mQueues.size() && !task; ++i) {
+            auto &queue = *mQueues[(own + i) % mQueues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+
+            if (i == 0 && currentPool == this) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+
+        if (!task) {
+            return false;
+        }
+
+        --mPending;
+        task();
+        return true;
+    }
+
+    void ThreadPool::work(Size index) {
+        currentPool = this;
+        currentQueue = index;
+
+        while (true) {
+            if (runPending()) {
+                continue;
+            }
+
+            std::unique_lock lock(mSleepMutex);
+            mWakeUp.wait(lock, [this] { return mStop || mPending != 0; });
+            if (mStop) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+namespace rise {
+    // Work-stealing pool. Every worker owns a queue, takes its own tasks from the back and
+    // steals from the front of the other queues when it runs out of work.
+    class ThreadPool : NonCopyable {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(Size threadCount = std::thread::hardware_concurrency());
+
+        ~ThreadPool();
+
+        Size threadCount() const {
+            return mWorkers.size();
+        }
+
+        void submit(Task task);
+
+        template<typename F>
+        auto async(F &&func) {
+            using Result = std::invoke_result_t<F>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+            auto future = task->get_future();
+            submit([task] { (*task)(); });
+            return future;
+        }
+
+        // Calls body(i) for every i in [0, count), grain indices per task. The calling thread
+        // runs queued tasks while it waits, so it is safe to call from inside a pool task.
+        template<typename F>
+        void parallelFor(Size count, F &&body, Size grain = 1) {
+            if (count == 0) {
+                return;
+            }
+            grain = std::max(grain, Size(1));
+
+            std::atomic<Size> remaining = (count + grain - 1) / grain;
+            std::exception_ptr error;
+            std::mutex errorMutex;
+
+            for (Size first = 0; first < count; first += grain) {
+                submit([&, first] {
+                    try {
+                        for (Size i = first, last = std::min(count, first + grain); i != last; ++i) {
+                            body(i);
+                        }
+                    } catch (...) {
+                        std::lock_guard lock(errorMutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    remaining.fetch_sub(1, std::memory_order_release);
+                });
+            }
+
+            while (remaining.load(std::memory_order_acquire) != 0) {
+                if (!runPending()) {
+                    std::this_thread::yield();
+                }
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            deque<Task> tasks;
+        };
+
+        bool runPending();
+
+        void work(Size index);
+
+        vector<std::unique_ptr<Queue>> mQueues;
+        vector<std::thread> mWorkers;
+        std::atomic<Size> mNextQueue = 0;
+        std::atomic<Size> mPending = 0;
+        std::atomic<bool> mStop = false;
+        std::mutex mSleepMutex;
+        std::condition_variable mWakeUp;
+    };
+}
@@ -1,9 +1,14 @@
 #include "MeshLoader.hpp"
 #include "../Exception.hpp"
+#include "VertexWriter.hpp"
+#include "MeshOptimizer.hpp"
+#include "../Compression.hpp"
+#include <cista/hash.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <glm/glm.hpp>
+#include <random>
 
 namespace rise {
     namespace {
@@ -11,6 +16,444 @@ namespace rise {
 
         constexpr auto serializeMode = cista::mode::WITH_INTEGRITY | cista::mode::UNCHECKED;
 
+        // one less than the 16 bit range, 0xFFFF is the primitive restart index
+        constexpr Size maxUint16Vertices = std::numeric_limits<uint16_t>::max();
+
+        // buffer regions of every format group start at this alignment
+        constexpr Size regionAlignment = 4;
+
+        Size alignRegion(Size size) {
+            return (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+        }
+
+        MeshData narrowIndices(MeshData const &data) {
+            MeshData result;
+            result.vertices = data.vertices;
+            result.meshlets = data.meshlets;
+
+            auto count = data.indices.size() / sizeof(uint32_t);
+            auto indices = reinterpret_cast<uint32_t const *>(data.indices.data());
+
+            result.indices.resize(count * sizeof(uint16_t));
+            auto narrowed = reinterpret_cast<uint16_t *>(result.indices.data());
+            for (Size i = 0; i != count; ++i) {
+                narrowed[i] = uint16_t(indices[i]);
+            }
+
+            return result;
+        }
+
+        // bump whenever conversion output changes for the same input, it invalidates every cache entry
+        constexpr uint64_t converterVersion = 4;
+
+        constexpr auto manifestName = "manifest.rise";
+
+        constexpr auto archiveName = "meshes.pack";
+        constexpr std::array<char, 8> archiveMagic = {'R', 'I', 'M', 'E', 'S', 'H', 'P', 'K'};
+        constexpr uint32_t archiveVersion = 2;
+
+        // blobs can be uploaded straight from the mapping with any common buffer offset alignment
+        constexpr Size archiveAlignment = 256;
+
+        // copies below this size are not split between threads
+        constexpr Size copyChunkSize = Size(1) << 20u;
+
+        // decoded size of compressed archive chunks, small enough to spread a single mesh over threads
+        constexpr Size compressedChunkSize = Size(1) << 17u;
+
+        // header, table, vertex blob and index blob follow each other, every part archiveAlignment aligned
+        struct ArchiveHeader {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t alignment;
+            uint64_t tableOffset;
+            uint64_t tableSize;
+            uint64_t vertexOffset;
+            uint64_t vertexSize;
+            uint64_t indexOffset;
+            uint64_t indexSize;
+            // stored sizes above, nonzero when the blobs are split into compressed chunks
+            uint32_t compressed;
+            uint32_t chunkSize;
+        };
+
+        Size alignArchive(Size size) {
+            return (size + archiveAlignment - 1) / archiveAlignment * archiveAlignment;
+        }
+
+        struct CopyRange {
+            uint8_t const *src;
+            uint8_t *dst;
+            Size size;
+        };
+
+        // neighbouring meshes are usually neighbours in both the source and the destination
+        void appendCopy(vector<CopyRange> &copies, CopyRange range) {
+            if (!copies.empty()) {
+                auto &last = copies.back();
+                if (last.src + last.size == range.src && last.dst + last.size == range.dst) {
+                    last.size += range.size;
+                    return;
+                }
+            }
+            copies.push_back(range);
+        }
+
+        void copyRanges(vector<CopyRange> const &copies, ThreadPool *pool) {
+            vector<CopyRange> chunks;
+            for (auto const &copy : copies) {
+                for (Size offset = 0; offset < copy.size; offset += copyChunkSize) {
+                    chunks.push_back({copy.src + offset, copy.dst + offset,
+                            std::min(copyChunkSize, copy.size - offset)});
+                }
+            }
+
+            auto copyChunk = [&chunks](Size i) {
+                memcpy(chunks[i].dst, chunks[i].src, chunks[i].size);
+            };
+            if (pool) {
+                pool->parallelFor(chunks.size(), copyChunk);
+            } else {
+                for (Size i = 0; i != chunks.size(); ++i) {
+                    copyChunk(i);
+                }
+            }
+        }
+
+        struct DecodeRange {
+            span<uint8_t const> src;
+            Size stride;
+            span<uint8_t> dst;
+        };
+
+        // chunks of a mesh are decoded back to back into its destination
+        void appendDecodes(vector<DecodeRange> &decodes, span<ArchiveChunkData const> chunks,
+                uint8_t const *blob, Size stride, uint8_t *dst) {
+            for (auto const &chunk : chunks) {
+                decodes.push_back({{blob + chunk.offset, chunk.storedSize}, stride, {dst, chunk.size}});
+                dst += chunk.size;
+            }
+        }
+
+        void decodeRanges(vector<DecodeRange> const &decodes, ThreadPool *pool) {
+            auto decodeChunk = [&decodes](Size i) {
+                decompressBlock(decodes[i].src, decodes[i].stride, decodes[i].dst);
+            };
+            if (pool) {
+                pool->parallelFor(decodes.size(), decodeChunk);
+            } else {
+                for (Size i = 0; i != decodes.size(); ++i) {
+                    decodeChunk(i);
+                }
+            }
+        }
+
+        span<std::byte const> toBytes(uint8_t const *data, Size size) {
+            return {reinterpret_cast<std::byte const *>(data), size};
+        }
+
+        // format group 8 bits, group 16 bits, mesh 32 bits, level of detail 8 bits, fields are masked so
+        // an out of range value cannot spill into the fields above it
+        uint64_t drawKey(Index formatGroup, uint32_t group, MeshDrawInfo const &draw) {
+            return (uint64_t(formatGroup) & 0xFFu) << 56u | (uint64_t(group) & 0xFFFFu) << 40u
+                    | (uint64_t(draw.mesh) & 0xFFFFFFFFu) << 8u | (uint64_t(draw.lod) & 0xFFu);
+        }
+
+        uint32_t keyGroup(uint64_t key) {
+            return uint32_t(key >> 40u & 0xFFFFu);
+        }
+
+        glm::vec3 toVec3(cista::array<float, 3> const &value) {
+            return {value[0], value[1], value[2]};
+        }
+
+        cista::array<float, 3> toArray(glm::vec3 const &value) {
+            return {value.x, value.y, value.z};
+        }
+
+        BoundsData toBoundsData(Bounds const &bounds) {
+            return {toArray(bounds.min), toArray(bounds.max), toArray(bounds.center), bounds.radius};
+        }
+
+        Bounds toBounds(BoundsData const &bounds) {
+            return {toVec3(bounds.min), toVec3(bounds.max), toVec3(bounds.center), bounds.radius};
+        }
+
+        PositionQuantizationData toQuantizationData(PositionQuantization const &quantization) {
+            return {toArray(quantization.scale), toArray(quantization.offset)};
+        }
+
+        PositionQuantization toQuantization(PositionQuantizationData const &quantization) {
+            return {toVec3(quantization.scale), toVec3(quantization.offset)};
+        }
+
+        Meshlet toMeshlet(MeshletData const &meshlet, Index meshFirstIndex) {
+            return {meshFirstIndex + meshlet.firstIndex, meshlet.indexCount, toVec3(meshlet.center), meshlet.radius,
+                    toVec3(meshlet.coneAxis), meshlet.coneCutoff, toVec3(meshlet.boundsMin), toVec3(meshlet.boundsMax)};
+        }
+
+        MeshArchiveTable const *openArchive(cista::mmap &archive, fs::path const &path) {
+            ArchiveHeader header = {};
+            if (archive.size() < sizeof(header)) {
+                throw FileError("Mesh archive is truncated", path);
+            }
+            memcpy(&header, archive.data(), sizeof(header));
+
+            if (header.magic != archiveMagic || header.version != archiveVersion) {
+                throw FileError("Unsupported mesh archive", path);
+            }
+
+            auto fits = [&archive](uint64_t offset, uint64_t size) {
+                return offset <= archive.size() && size <= archive.size() - offset;
+            };
+            if (!fits(header.tableOffset, header.tableSize) || !fits(header.vertexOffset, header.vertexSize)
+                    || !fits(header.indexOffset, header.indexSize)) {
+                throw FileError("Mesh archive is truncated", path);
+            }
+
+            auto tableBegin = archive.data() + header.tableOffset;
+            auto table = cista::deserialize<MeshArchiveTable, serializeMode>(tableBegin,
+                    tableBegin + header.tableSize);
+            if (!table) {
+                throw FileError("Fail to load mesh archive table", path);
+            }
+
+            auto chunksFit = [&](uint32_t first, uint32_t count, uint64_t size, uint64_t blobSize) {
+                if (uint64_t(first) + count > table->chunks.size()) {
+                    return false;
+                }
+                uint64_t decoded = 0;
+                for (auto const &chunk : span(table->chunks.data() + first, count)) {
+                    if (chunk.offset > blobSize || chunk.storedSize > blobSize - chunk.offset) {
+                        return false;
+                    }
+                    decoded += chunk.size;
+                }
+                return decoded == size;
+            };
+
+            for (auto const &[name, mesh] : table->directory) {
+                auto inRange = header.compressed
+                        ? chunksFit(mesh.firstVertexChunk, mesh.vertexChunkCount, mesh.vertexSize, header.vertexSize)
+                                && chunksFit(mesh.firstIndexChunk, mesh.indexChunkCount, mesh.indexSize,
+                                        header.indexSize)
+                        : mesh.vertexOffset + mesh.vertexSize <= header.vertexSize
+                                && mesh.indexOffset + mesh.indexSize <= header.indexSize;
+                if (!inRange || mesh.firstMeshlet + mesh.meshletCount > table->meshlets.size()) {
+                    throw FileError("Mesh archive directory is out of range: " + name.str(), path);
+                }
+            }
+
+            return table;
+        }
+
+        // Splits data into chunks of whole elements and appends them to the stored blob
+        pair<uint32_t, uint32_t> compressChunks(binary::vector<uint8_t> const &data, Size stride,
+                vector<ArchiveChunkData> &chunks, vector<uint8_t> &blob) {
+            auto first = uint32_t(chunks.size());
+            auto chunkSize = std::max(compressedChunkSize / stride, Size(1)) * stride;
+            for (Size offset = 0; offset < data.size(); offset += chunkSize) {
+                auto size = std::min(chunkSize, data.size() - offset);
+                auto blobOffset = blob.size();
+                auto storedSize = compressBlock({data.data() + offset, size}, stride, blob);
+                chunks.push_back({blobOffset, storedSize, size});
+            }
+            return {first, uint32_t(chunks.size()) - first};
+        }
+
+        void writeArchive(fs::path const &path, VertexFormatData const &format,
+                map <string, MeshData> const &meshes, Size vertexStride, bool compress) {
+            MeshArchiveTable table;
+            table.format = format;
+
+            vector<uint8_t const *> vertexBlobs, indexBlobs;
+            vector<Size> vertexSizes, indexSizes;
+            vector<MeshData> narrowed;
+            narrowed.reserve(meshes.size());
+
+            auto indexStride = indexSize(format.indexType);
+            vector<ArchiveChunkData> chunks;
+            vector<uint8_t> vertexStored, indexStored;
+
+            // name order matches the destination layout of a full import, it becomes two copies
+            uint64_t vertexSize = 0, indexSize = 0;
+            for (auto const &[name, data] : meshes) {
+                auto const *mesh = &data;
+                if (format.indexType == IndexType::Uint16) {
+                    mesh = &narrowed.emplace_back(narrowIndices(data));
+                }
+
+                ArchiveMeshData entry = {};
+                entry.vertexOffset = vertexSize;
+                entry.vertexSize = mesh->vertices.size();
+                entry.indexOffset = indexSize;
+                entry.indexSize = mesh->indices.size();
+                entry.firstMeshlet = table.meshlets.size();
+                entry.meshletCount = mesh->meshlets.size();
+                for (auto const &meshlet : mesh->meshlets) {
+                    table.meshlets.push_back(meshlet);
+                }
+
+                if (compress) {
+                    std::tie(entry.firstVertexChunk, entry.vertexChunkCount) =
+                            compressChunks(mesh->vertices, vertexStride, chunks, vertexStored);
+                    std::tie(entry.firstIndexChunk, entry.indexChunkCount) =
+                            compressChunks(mesh->indices, indexStride, chunks, indexStored);
+                } else {
+                    vertexBlobs.push_back(mesh->vertices.data());
+                    vertexSizes.push_back(mesh->vertices.size());
+                    indexBlobs.push_back(mesh->indices.data());
+                    indexSizes.push_back(mesh->indices.size());
+                }
+                table.directory.emplace(name.c_str(), entry);
+
+                vertexSize += entry.vertexSize;
+                indexSize += entry.indexSize;
+            }
+
+            if (compress) {
+                spdlog::info("Mesh archive {}: compressed {} -> {} bytes in {} chunks", path.string(),
+                        vertexSize + indexSize, vertexStored.size() + indexStored.size(), chunks.size());
+
+                vertexBlobs = {vertexStored.data()};
+                vertexSizes = {vertexStored.size()};
+                indexBlobs = {indexStored.data()};
+                indexSizes = {indexStored.size()};
+                vertexSize = vertexStored.size();
+                indexSize = indexStored.size();
+                for (auto const &chunk : chunks) {
+                    table.chunks.push_back(chunk);
+                }
+            }
+
+            auto tableData = cista::serialize<serializeMode>(table);
+
+            ArchiveHeader header = {};
+            header.magic = archiveMagic;
+            header.version = archiveVersion;
+            header.alignment = archiveAlignment;
+            header.tableOffset = alignArchive(sizeof(header));
+            header.tableSize = tableData.size();
+            header.vertexOffset = alignArchive(header.tableOffset + header.tableSize);
+            header.vertexSize = vertexSize;
+            header.indexOffset = alignArchive(header.vertexOffset + header.vertexSize);
+            header.indexSize = indexSize;
+            header.compressed = compress;
+            header.chunkSize = compress ? compressedChunkSize : 0;
+
+            ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                throw FileError("Fail to create mesh archive", path);
+            }
+
+            auto padTo = [&file](uint64_t offset) {
+                static constexpr std::array<char, archiveAlignment> zeros = {};
+                auto position = uint64_t(file.tellp());
+                file.write(zeros.data(), std::streamsize(offset - position));
+            };
+
+            file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+            padTo(header.tableOffset);
+            file.write(reinterpret_cast<char const *>(tableData.data()), std::streamsize(tableData.size()));
+            padTo(header.vertexOffset);
+            for (Size i = 0; i != vertexBlobs.size(); ++i) {
+                file.write(reinterpret_cast<char const *>(vertexBlobs[i]), std::streamsize(vertexSizes[i]));
+            }
+            padTo(header.indexOffset);
+            for (Size i = 0; i != indexBlobs.size(); ++i) {
+                file.write(reinterpret_cast<char const *>(indexBlobs[i]), std::streamsize(indexSizes[i]));
+            }
+
+            if (!file) {
+                throw FileError("Fail to write mesh archive", path);
+            }
+        }
+
+        template<typename T>
+        uint64_t hashValue(T const &value, uint64_t hash) {
+            static_assert(std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>);
+            return cista::hash(string_view(reinterpret_cast<char const *>(&value), sizeof(value)), hash);
+        }
+
+        uint64_t hashValue(float value, uint64_t hash) {
+            return hashValue(std::bit_cast<uint32_t>(value), hash);
+        }
+
+        uint64_t hashValue(bool value, uint64_t hash) {
+            return hashValue(uint8_t(value), hash);
+        }
+
+        uint64_t hashBytes(span<uint8_t const> bytes, uint64_t hash) {
+            return cista::hash(string_view(reinterpret_cast<char const *>(bytes.data()), bytes.size()), hash);
+        }
+
+        string cacheName(uint64_t key) {
+            return fmt::format("{:016x}.rimc", key);
+        }
+
+        optional<CachedMeshData const *> readCache(cista::mmap &file, uint64_t key) {
+            auto cached = cista::deserialize<CachedMeshData, serializeMode>(file);
+            if (!cached || cached->key != key) {
+                return {};
+            }
+            return cached;
+        }
+
+        void writeFile(fs::path const &path, span<uint8_t const> bytes) {
+            ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<char const *>(bytes.data()), std::streamsize(bytes.size()));
+            if (!file) {
+                throw FileError("Fail to write converted meshes", path);
+            }
+        }
+
+        // sibling of path to write before renaming it over path, random so threads and processes
+        // writing the same file never share one
+        fs::path uniqueTempPath(fs::path const &path) {
+            thread_local std::mt19937_64 random(std::random_device{}());
+            return fs::path(path).concat(fmt::format(".{:016x}.tmp", random()));
+        }
+
+        // rewrites path only when its key differs from the last conversion into the folder
+        template<typename Write>
+        void writeOutput(fs::path const &path, uint64_t key, OutputManifestData &manifest, Write &&write) {
+            auto name = path.filename().string();
+            auto previous = manifest.outputs.find(name.c_str());
+            if (previous != manifest.outputs.end() && previous->second == key && fs::exists(path)) {
+                spdlog::info("Output {} is up to date", path.string());
+                return;
+            }
+
+            write();
+            manifest.outputs[name.c_str()] = key;
+        }
+
+        // drops an output of the other storage so the importer can not pick it up instead of the new one
+        void removeOutput(fs::path const &path, OutputManifestData &manifest) {
+            if (fs::remove(path)) {
+                spdlog::info("Removed stale output {}", path.string());
+            }
+            auto name = path.filename().string();
+            if (auto entry = manifest.outputs.find(name.c_str()); entry != manifest.outputs.end()) {
+                manifest.outputs.erase(entry);
+            }
+        }
+
+        OutputManifestData readManifest(fs::path const &dst) {
+            auto path = dst / manifestName;
+            if (!fs::exists(path)) {
+                return {};
+            }
+
+            cista::mmap file(path.c_str(), cista::mmap::protection::READ);
+            auto manifest = cista::deserialize<OutputManifestData, serializeMode>(file);
+            if (!manifest) {
+                spdlog::warn("Ignoring damaged output manifest {}", path.string());
+                return {};
+            }
+            return *manifest;
+        }
+
         auto getAttributes(const vector <MeshConvertOp> &options) {
             binary::hash_map<binary::string, VertexAttributeData> result;
             Size vertexSize = 0;
@@ -22,72 +465,171 @@ namespace rise {
             return result;
         }
 
-        template<typename T>
-        void writeToBuffer(binary::vector<uint8_t> &buffer, T const &obj) {
-            auto currentPos = buffer.size();
-            buffer.resize(currentPos + sizeof(T));
-            memcpy(buffer.data() + currentPos, &obj, sizeof(T));
-        }
-
-        void writeAttrib(MeshData &data, Format format, aiVector3D vec) {
-            switch (format) {
-                case Format::R32G32B32Sfloat:
-                    return writeToBuffer(data.vertices, glm::vec<3, float>(vec.x, vec.y, vec.z));
-                case Format::R32G32Sfloat:
-                    return writeToBuffer(data.vertices, glm::vec<2, float>(vec.x, vec.y));
-                default:
-                    throw std::runtime_error("not implemented format!");
-            }
-        }
-
-        void writeVertices(aiMesh const *mesh, vector <MeshConvertOp> const &ops, MeshData &data) {
-            for (size_t i = 0; i != mesh->mNumVertices; ++i) {
-                for (auto const &op : ops) {
-                    switch (op.type) {
-                        case MeshAttribute::Position:
-                            writeAttrib(data, op.format, mesh->mVertices[i]);
-                            break;
-                        case MeshAttribute::Normal:
-                            writeAttrib(data, op.format, mesh->mNormals[i]);
-                            break;
-                        case MeshAttribute::TextCoord:
-                            writeAttrib(data, op.format, mesh->mTextureCoords[i][0]);
-                            break;
-                        default:
-                            throw std::runtime_error("not implemented format!");
-                    }
-                }
+        span<glm::vec3 const> toStream(aiVector3D const *data, Size count) {
+            static_assert(sizeof(aiVector3D) == sizeof(glm::vec3));
+            if (!data) {
+                return {};
+            }
+            return {reinterpret_cast<glm::vec3 const *>(data), count};
+        }
+
+        VertexStreams getStreams(aiMesh const *mesh) {
+            VertexStreams streams;
+            streams.positions = toStream(mesh->mVertices, mesh->mNumVertices);
+            streams.normals = toStream(mesh->mNormals, mesh->mNumVertices);
+            streams.textCoords = toStream(mesh->mTextureCoords[0], mesh->mNumVertices);
+            if (mesh->mColors[0]) {
+                static_assert(sizeof(aiColor4D) == sizeof(glm::vec4));
+                streams.colors = {reinterpret_cast<glm::vec4 const *>(mesh->mColors[0]), mesh->mNumVertices};
             }
+            return streams;
         }
 
-        void writeIndices(aiMesh const *mesh, MeshData &data, Offset &vertexOffset) {
+        void writeIndices(aiMesh const *mesh, uint32_t *dst, Offset &vertexOffset) {
             for (uint32_t f = 0; f < mesh->mNumFaces; f++) {
                 for (uint32_t j = 0; j < 3; j++) {
-                    writeToBuffer(
-                            data.indices,
-                            uint32_t(vertexOffset + mesh->mFaces[f].mIndices[j]));
+                    *dst++ = uint32_t(vertexOffset + mesh->mFaces[f].mIndices[j]);
                 }
             }
             vertexOffset += mesh->mNumVertices;
         }
 
-        MeshData convertMesh(fs::path const &path, vector <MeshConvertOp> const &ops,
+        void optimizeMesh(fs::path const &path, MeshData &data, VertexWriter const &writer,
+                MeshOptimizeOptions const &options, Size &vertexCount, ThreadPool *pool) {
+            auto vertexSize = writer.vertexSize();
+            span<uint32_t> indices(reinterpret_cast<uint32_t *>(data.indices.data()),
+                    data.indices.size() / sizeof(uint32_t));
+
+            if (options.weldVertices && vertexCount != 0) {
+                auto welded = weldVertices(indices, {data.vertices.data(), data.vertices.size()},
+                        vertexSize, pool);
+                spdlog::info("Mesh {}: welded {} -> {} vertices ({:.1f}%)", path.string(), vertexCount,
+                        welded, 100.f * float(welded) / float(vertexCount));
+
+                vertexCount = welded;
+                data.vertices.resize(vertexCount * vertexSize);
+            }
+
+            auto before = analyzeVertexCache(indices, vertexCount, options.cacheSize);
+
+            if (options.vertexCache) {
+                optimizeVertexCache(indices, vertexCount);
+            }
+
+            if (options.overdraw) {
+                auto positions = writer.decodePositions(data.vertices.data(), vertexCount);
+                if (positions.empty()) {
+                    spdlog::warn("Mesh {} has no positions, overdraw optimization skipped", path.string());
+                } else {
+                    optimizeOverdraw(indices, positions, options.cacheSize, options.overdrawThreshold);
+                }
+            }
+
+            auto after = analyzeVertexCache(indices, vertexCount, options.cacheSize);
+            spdlog::info("Mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path.string(),
+                    before.acmr, after.acmr, before.atvr, after.atvr);
+
+            if (options.vertexFetch) {
+                vertexCount = optimizeVertexFetch(indices, {data.vertices.data(), data.vertices.size()}, vertexSize);
+                data.vertices.resize(vertexCount * vertexSize);
+            }
+        }
+
+        vector<LodData> generateLods(fs::path const &path, MeshData &data, VertexWriter const &writer,
+                LodOptions const &options, bool optimizeCache, Size vertexCount) {
+            auto positions = writer.decodePositions(data.vertices.data(), vertexCount);
+            if (positions.empty()) {
+                throw std::runtime_error("LODs need a position attribute");
+            }
+
+            auto source = reinterpret_cast<uint32_t const *>(data.indices.data());
+            vector<uint32_t> current(source, source + data.indices.size() / sizeof(uint32_t));
+
+            vector<LodData> lods = {{0, uint32_t(current.size()), 0.f}};
+            float error = 0.f;
+            Size indexCount = current.size();
+
+            while (lods.size() < options.maxLevels) {
+                auto target = Size(float(current.size() / 3) * options.reduction) * 3;
+                float levelError = 0.f;
+                auto simplified = simplifyMesh(current, positions, target, options.maxError, levelError);
+                if (simplified.size() >= current.size()) {
+                    break;
+                }
+
+                if (optimizeCache) {
+                    optimizeVertexCache(simplified, vertexCount);
+                }
+
+                error = std::max(error, levelError);
+                lods.push_back({uint32_t(indexCount), uint32_t(simplified.size()), error});
+                spdlog::info("Mesh {}: LOD {} has {} triangles, error {:.4f}", path.string(),
+                        lods.size() - 1, simplified.size() / 3, error);
+
+                data.indices.resize((indexCount + simplified.size()) * sizeof(uint32_t));
+                memcpy(data.indices.data() + indexCount * sizeof(uint32_t), simplified.data(),
+                        simplified.size() * sizeof(uint32_t));
+                indexCount += simplified.size();
+
+                current = std::move(simplified);
+            }
+
+            return lods;
+        }
+
+        MeshData convertMesh(fs::path const &path, VertexWriter &writer,
                 Size &vertexCount, Size &indexCount) {
             MeshData data;
 
             Assimp::Importer importer;
             auto scene = importer.ReadFile(path.string(),
                     aiProcessPreset_TargetRealtime_MaxQuality);
+            if (!scene) {
+                throw FileError(string("Fail to import mesh: ") + importer.GetErrorString() + " ", path);
+            }
 
             for (size_t i = 0; i != scene->mNumMeshes; ++i) {
-                writeVertices(scene->mMeshes[i], ops, data);
                 vertexCount += scene->mMeshes[i]->mNumVertices;
+                indexCount += scene->mMeshes[i]->mNumFaces * 3;
             }
 
-            Offset vertexOffset;
+            data.vertices.resize(vertexCount * writer.vertexSize());
+            data.indices.resize(indexCount * sizeof(uint32_t));
+
+            // bounds relative positions share one range over all sub meshes
+            glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
             for (size_t i = 0; i != scene->mNumMeshes; ++i) {
-                writeIndices(scene->mMeshes[i], data, vertexOffset);
-                indexCount += scene->mMeshes[i]->mNumFaces * 3;
+                for (auto const &p : getStreams(scene->mMeshes[i]).positions) {
+                    min = glm::min(min, p);
+                    max = glm::max(max, p);
+                }
+            }
+            if (vertexCount != 0) {
+                writer.setPositionBounds(min, max);
+            }
+
+            QuantizationError error;
+            auto vertices = data.vertices.data();
+            for (size_t i = 0; i != scene->mNumMeshes; ++i) {
+                auto mesh = scene->mMeshes[i];
+                auto streams = getStreams(mesh);
+                writer.write(streams, mesh->mNumVertices, vertices);
+
+                auto meshError = writer.measureError(streams, mesh->mNumVertices, vertices);
+                error.position = std::max(error.position, meshError.position);
+                error.normalDegrees = std::max(error.normalDegrees, meshError.normalDegrees);
+                error.textCoord = std::max(error.textCoord, meshError.textCoord);
+
+                vertices += mesh->mNumVertices * writer.vertexSize();
+            }
+            spdlog::info("Mesh {}: {} byte vertices, max error position {:.6f} normal {:.3f} deg texture {:.6f}",
+                    path.string(), writer.vertexSize(), error.position, error.normalDegrees, error.textCoord);
+
+            Offset vertexOffset = 0;
+            auto indices = reinterpret_cast<uint32_t *>(data.indices.data());
+            for (size_t i = 0; i != scene->mNumMeshes; ++i) {
+                writeIndices(scene->mMeshes[i], indices, vertexOffset);
+                indices += scene->mMeshes[i]->mNumFaces * 3;
             }
 
             return data;
@@ -110,54 +652,124 @@ namespace rise {
         }
 
         auto convertMeshes(util::VertexFormatData const *data, Size vertexSize,
-                Size &sizeForVertices, Size &sizeForIndices, vector <string> const &meshes) {
+                Size &sizeForVertices, Size &sizeForIndices, vector <string> const &meshes,
+                map <string, vector<MeshLod>> &lods, map <string, Bounds> &bounds,
+                map <string, PositionQuantization> &quantization) {
             map <string, MeshDrawInfo> result;
+            map <string, MeshInfoData const *> sources;
 
             for (auto const &mesh : data->meshes) {
                 if (ranges::find(meshes, mesh.first.str()) != meshes.end()) {
                     spdlog::info("Found mesh: {}", mesh.first);
 
-                    result.emplace(mesh.first.str(), MeshDrawInfo{
-                            mesh.second.firstIndex, mesh.second.indexCount});
+                    MeshDrawInfo drawInfo = {};
+                    drawInfo.indexCount = mesh.second.lods.empty() ? mesh.second.indexCount
+                            : mesh.second.lods[0].indexCount;
+                    drawInfo.indexType = data->indexType;
+                    drawInfo.meshletCount = mesh.second.meshletCount;
+                    result.emplace(mesh.first.str(), drawInfo);
+                    sources.emplace(mesh.first.str(), &mesh.second);
+                }
+            }
+
+            // meshes are placed in name order, the same order load copies them in
+            Size vertexCount = 0, indexCount = 0, meshletCount = 0;
+            for (auto &[name, drawInfo] : result) {
+                auto const &source = *sources.at(name);
+                drawInfo.firstIndex = indexCount;
+                drawInfo.vertexOffset = vertexCount;
+                drawInfo.firstMeshlet = meshletCount;
+
+                bounds.emplace(name, toBounds(source.bounds));
+                quantization.emplace(name, toQuantization(source.quantization));
 
-                    sizeForVertices += mesh.second.vertexCount * vertexSize;
-                    sizeForIndices += mesh.second.indexCount * sizeof(uint32_t);
+                auto &meshLods = lods[name];
+                for (auto const &lod : source.lods) {
+                    meshLods.push_back({drawInfo.firstIndex + lod.firstIndex, lod.indexCount, lod.error});
                 }
+
+                vertexCount += source.vertexCount;
+                indexCount += source.indexCount;
+                meshletCount += drawInfo.meshletCount;
             }
 
+            sizeForVertices = alignRegion(vertexCount * vertexSize);
+            sizeForIndices = alignRegion(indexCount * indexSize(data->indexType));
+
             return result;
         }
     }
 
     MeshFolderImporter::MeshFolderImporter(fs::path const &folder, vector <string> const &meshes)
             : mFolder(folder) {
-        auto formatPath = folder / "format.rise";
-        if (!fs::exists(formatPath)) {
-            throw std::runtime_error("mesh imported format not found");
-        }
-        spdlog::info("Load mesh format: {}", formatPath.string());
+        cista::mmap formatFile;
+        util::VertexFormatData const *formatData = nullptr;
+
+        auto archivePath = folder / archiveName;
+        if (fs::exists(archivePath)) {
+            spdlog::info("Load mesh archive: {}", archivePath.string());
+
+            mArchive = std::make_shared<cista::mmap>(archivePath.c_str(), cista::mmap::protection::READ);
+            mArchiveTable = openArchive(*mArchive, archivePath);
+            formatData = &mArchiveTable->format;
+        } else {
+            auto formatPath = folder / "format.rise";
+            if (!fs::exists(formatPath)) {
+                throw std::runtime_error("mesh imported format not found");
+            }
+            spdlog::info("Load mesh format: {}", formatPath.string());
 
-        cista::mmap formatFile(formatPath.c_str(), cista::mmap::protection::READ);
-        auto formatData = cista::deserialize<util::VertexFormatData, serializeMode>(formatFile);
+            formatFile = cista::mmap(formatPath.c_str(), cista::mmap::protection::READ);
+            formatData = cista::deserialize<util::VertexFormatData, serializeMode>(formatFile);
 
-        if (!formatData) {
-            throw std::runtime_error("Fail to load mesh format");
+            if (!formatData) {
+                throw std::runtime_error("Fail to load mesh format");
+            }
         }
 
-        Size vertexSize = 0;
-        mMeshes.format = convertVertexFormat(formatData, vertexSize);
-        mMeshes.meshInfo = convertMeshes(formatData, vertexSize,
-                mSizeForVertices, mSizeForIndices, meshes);
+        mMeshes.format = convertVertexFormat(formatData, mVertexSize);
+        mMeshes.vertexSize = mVertexSize;
+        mMeshes.indexType = formatData->indexType;
+        mMeshes.meshInfo = convertMeshes(formatData, mVertexSize,
+                mSizeForVertices, mSizeForIndices, meshes, mMeshes.lods, mMeshes.bounds,
+                mMeshes.quantization);
     }
 
-    FolderMeshes MeshFolderImporter::load(MemData vertexData, MemData indexData) {
-        assert(vertexData.size >= sizeForVertices() || indexData.size >= sizeForIndices());
+    FolderMeshes MeshFolderImporter::load(MemData vertexData, MemData indexData, ThreadPool *pool) {
+        assert(vertexData.size >= sizeForVertices() && indexData.size >= sizeForIndices());
+
+        spdlog::info("Loading vertices and indices of {} to buffer", name());
+        auto start = time::steady_clock::now();
+
+        vector<vector<Meshlet>> meshlets(mMeshes.meshInfo.size());
+        if (mArchiveTable) {
+            loadArchive(vertexData, indexData, pool, meshlets);
+        } else {
+            loadFiles(vertexData, indexData, pool, meshlets);
+        }
+
+        // meshlets follow mesh name order, the order firstMeshlet was assigned in
+        for (auto &meshMeshlets : meshlets) {
+            mMeshes.meshlets.insert(mMeshes.meshlets.end(), meshMeshlets.begin(), meshMeshlets.end());
+        }
+
+        time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+        spdlog::info("Loaded {} meshes of {} in {:.2f} ms", mMeshes.meshInfo.size(), name(), elapsed.count());
+
+        return std::move(mMeshes);
+    }
 
-        spdlog::info("Loading vertices and indices to buffer");
+    void MeshFolderImporter::loadFiles(MemData vertexData, MemData indexData, ThreadPool *pool,
+            vector<vector<Meshlet>> &meshlets) const {
+        vector<pair<string const *, MeshDrawInfo const *>> entries;
+        entries.reserve(mMeshes.meshInfo.size());
+        for (auto const &[meshName, drawInfo] : mMeshes.meshInfo) {
+            entries.emplace_back(&meshName, &drawInfo);
+        }
 
-        Offset currentVertexOffset = 0, currentIndexOffset = 0;
-        for (auto const &info : mMeshes.meshInfo) {
-            auto const &meshName = info.first;
+        auto loadMesh = [&](Size i) {
+            auto const &meshName = *entries[i].first;
+            auto const &drawInfo = *entries[i].second;
             auto path = mFolder / (meshName + ".rim");
             if (!fs::exists(path)) {
                 throw FileError("Mesh file not found: " + meshName, path);
@@ -168,16 +780,319 @@ namespace rise {
             cista::mmap mmap(path.c_str(), cista::mmap::protection::READ);
             auto meshData = cista::deserialize<MeshData, serializeMode>(mmap);
 
-            memcpy(reinterpret_cast<uint8_t *>(vertexData.data) + currentVertexOffset,
+            auto vertexOffset = drawInfo.vertexOffset * mVertexSize;
+            auto indexOffset = drawInfo.firstIndex * indexSize(mMeshes.indexType);
+            if (vertexOffset + meshData->vertices.size() > sizeForVertices()
+                    || indexOffset + meshData->indices.size() > sizeForIndices()) {
+                throw FileError("Mesh data does not match its format table: " + meshName, path);
+            }
+
+            memcpy(reinterpret_cast<uint8_t *>(vertexData.data) + vertexOffset,
                     meshData->vertices.data(), meshData->vertices.size());
-            memcpy(reinterpret_cast<uint8_t *>(indexData.data) + currentIndexOffset,
+            memcpy(reinterpret_cast<uint8_t *>(indexData.data) + indexOffset,
                     meshData->indices.data(), meshData->indices.size());
 
-            currentVertexOffset += meshData->vertices.size();
-            currentIndexOffset += meshData->indices.size();
+            meshlets[i].reserve(meshData->meshlets.size());
+            for (auto const &meshlet : meshData->meshlets) {
+                meshlets[i].push_back(toMeshlet(meshlet, drawInfo.firstIndex));
+            }
+        };
+
+        if (pool) {
+            pool->parallelFor(entries.size(), loadMesh);
+        } else {
+            for (Size i = 0; i != entries.size(); ++i) {
+                loadMesh(i);
+            }
+        }
+    }
+
+    void MeshFolderImporter::loadArchive(MemData vertexData, MemData indexData, ThreadPool *pool,
+            vector<vector<Meshlet>> &meshlets) const {
+        ArchiveHeader header = {};
+        memcpy(&header, mArchive->data(), sizeof(header));
+        auto vertexBlob = mArchive->data() + header.vertexOffset;
+        auto indexBlob = mArchive->data() + header.indexOffset;
+
+        auto compressed = compressedArchive();
+        span<ArchiveChunkData const> chunks(mArchiveTable->chunks.data(), mArchiveTable->chunks.size());
+
+        vector<CopyRange> vertexCopies, indexCopies;
+        vector<DecodeRange> decodes;
+        Size i = 0;
+        for (auto const &[meshName, drawInfo] : mMeshes.meshInfo) {
+            auto const &entry = mArchiveTable->directory.at(meshName.c_str());
+
+            auto vertexOffset = drawInfo.vertexOffset * mVertexSize;
+            auto indexOffset = drawInfo.firstIndex * indexSize(mMeshes.indexType);
+            if (vertexOffset + entry.vertexSize > sizeForVertices()
+                    || indexOffset + entry.indexSize > sizeForIndices()) {
+                throw FileError("Mesh data does not match its format table: " + meshName, mFolder / archiveName);
+            }
+
+            auto vertexDst = reinterpret_cast<uint8_t *>(vertexData.data) + vertexOffset;
+            auto indexDst = reinterpret_cast<uint8_t *>(indexData.data) + indexOffset;
+            if (compressed) {
+                appendDecodes(decodes, chunks.subspan(entry.firstVertexChunk, entry.vertexChunkCount),
+                        vertexBlob, mVertexSize, vertexDst);
+                appendDecodes(decodes, chunks.subspan(entry.firstIndexChunk, entry.indexChunkCount),
+                        indexBlob, indexSize(mMeshes.indexType), indexDst);
+            } else {
+                appendCopy(vertexCopies, {vertexBlob + entry.vertexOffset, vertexDst, entry.vertexSize});
+                appendCopy(indexCopies, {indexBlob + entry.indexOffset, indexDst, entry.indexSize});
+            }
+
+            auto &meshMeshlets = meshlets[i++];
+            meshMeshlets.reserve(entry.meshletCount);
+            for (Size m = entry.firstMeshlet; m != entry.firstMeshlet + entry.meshletCount; ++m) {
+                meshMeshlets.push_back(toMeshlet(mArchiveTable->meshlets[m], drawInfo.firstIndex));
+            }
         }
 
-        return std::move(mMeshes);
+        if (compressed) {
+            spdlog::info("Archive {}: {} compressed chunks", name(), decodes.size());
+            decodeRanges(decodes, pool);
+            return;
+        }
+
+        spdlog::info("Archive {}: {} vertex and {} index copies", name(), vertexCopies.size(), indexCopies.size());
+
+        vertexCopies.insert(vertexCopies.end(), indexCopies.begin(), indexCopies.end());
+        copyRanges(vertexCopies, pool);
+    }
+
+    void MeshFolderImporter::mapMeshes(MappedMeshes &mapped, ThreadPool *pool) const {
+        auto groupIndex = mapped.mGroups.size();
+
+        MappedFormatGroup group;
+        group.name = name();
+        group.format = mMeshes.format;
+        group.vertexSize = mVertexSize;
+        group.indexType = mMeshes.indexType;
+
+        vector<pair<string const *, MeshDrawInfo const *>> entries;
+        for (auto const &[meshName, drawInfo] : mMeshes.meshInfo) {
+            entries.emplace_back(&meshName, &drawInfo);
+        }
+        vector<MappedMesh> meshes(entries.size());
+
+        auto addLods = [this](MappedMesh &mesh, string const &meshName, MeshDrawInfo const &drawInfo) {
+            if (auto lods = mMeshes.lods.find(meshName); lods != mMeshes.lods.end()) {
+                for (auto const &lod : lods->second) {
+                    mesh.lods.push_back({lod.firstIndex - drawInfo.firstIndex, lod.indexCount, lod.error});
+                }
+            }
+            if (mesh.lods.empty()) {
+                mesh.lods.push_back({0, drawInfo.indexCount});
+            }
+        };
+
+        if (compressedArchive() && !entries.empty()) {
+            throw FileError("Compressed mesh archives can not be mapped, load them instead", mFolder / archiveName);
+        }
+
+        if (mArchiveTable) {
+            ArchiveHeader header = {};
+            memcpy(&header, mArchive->data(), sizeof(header));
+            auto vertexBlob = mArchive->data() + header.vertexOffset;
+            auto indexBlob = mArchive->data() + header.indexOffset;
+            group.vertices = toBytes(vertexBlob, header.vertexSize);
+            group.indices = toBytes(indexBlob, header.indexSize);
+
+            for (Size i = 0; i != entries.size(); ++i) {
+                auto const &entry = mArchiveTable->directory.at(entries[i].first->c_str());
+                auto &mesh = meshes[i];
+                mesh.vertices = toBytes(vertexBlob + entry.vertexOffset, entry.vertexSize);
+                mesh.indices = toBytes(indexBlob + entry.indexOffset, entry.indexSize);
+                for (Size m = entry.firstMeshlet; m != entry.firstMeshlet + entry.meshletCount; ++m) {
+                    mesh.meshlets.push_back(toMeshlet(mArchiveTable->meshlets[m], 0));
+                }
+            }
+            mapped.mMappings.push_back(mArchive);
+        } else {
+            vector<std::shared_ptr<cista::mmap>> mappings(entries.size());
+
+            auto mapMesh = [&](Size i) {
+                auto const &meshName = *entries[i].first;
+                auto path = mFolder / (meshName + ".rim");
+                if (!fs::exists(path)) {
+                    throw FileError("Mesh file not found: " + meshName, path);
+                }
+
+                mappings[i] = std::make_shared<cista::mmap>(path.c_str(), cista::mmap::protection::READ);
+                auto meshData = cista::deserialize<MeshData, serializeMode>(*mappings[i]);
+
+                auto &mesh = meshes[i];
+                mesh.vertices = toBytes(meshData->vertices.data(), meshData->vertices.size());
+                mesh.indices = toBytes(meshData->indices.data(), meshData->indices.size());
+                for (auto const &meshlet : meshData->meshlets) {
+                    mesh.meshlets.push_back(toMeshlet(meshlet, 0));
+                }
+            };
+
+            if (pool) {
+                pool->parallelFor(entries.size(), mapMesh);
+            } else {
+                for (Size i = 0; i != entries.size(); ++i) {
+                    mapMesh(i);
+                }
+            }
+            mapped.mMappings.insert(mapped.mMappings.end(), mappings.begin(), mappings.end());
+        }
+
+        for (Size i = 0; i != entries.size(); ++i) {
+            meshes[i].formatGroup = groupIndex;
+            meshes[i].bounds = mMeshes.bounds.at(*entries[i].first);
+            meshes[i].quantization = mMeshes.quantization.at(*entries[i].first);
+            addLods(meshes[i], *entries[i].first, *entries[i].second);
+            mapped.mMeshes.emplace(*entries[i].first, std::move(meshes[i]));
+        }
+        mapped.mGroups.push_back(std::move(group));
+    }
+
+    vector<MeshConvertOp> quantizedOps(QuantizationPreset preset) {
+        switch (preset) {
+            case QuantizationPreset::Quality:
+                return {
+                        {"inPositions", MeshAttribute::Position, Format::R16G16B16A16Unorm,
+                                AttributeEncoding::BoundsRelative},
+                        {"inNormals", MeshAttribute::Normal, Format::R16G16Snorm, AttributeEncoding::Octahedral},
+                        {"inTextCoords", MeshAttribute::TextCoord, Format::R16G16Sfloat},
+                };
+            case QuantizationPreset::Compact:
+                return {
+                        // three component 16 bit formats are rarely supported for vertex input
+                        {"inPositions", MeshAttribute::Position, Format::R16G16B16A16Unorm,
+                                AttributeEncoding::BoundsRelative},
+                        {"inNormals", MeshAttribute::Normal, Format::R8G8Snorm, AttributeEncoding::Octahedral},
+                        {"inTextCoords", MeshAttribute::TextCoord, Format::R16G16Sfloat},
+                };
+        }
+        throw std::runtime_error("not implemented quantization preset!");
+    }
+
+    void MeshConverter::setCache(fs::path const &folder) {
+        fs::create_directories(folder);
+        mCache = folder;
+    }
+
+    // Sources referencing other files, like glTF buffers, are keyed on the main file only
+    uint64_t MeshConverter::sourceKey(fs::path const &path) const {
+        auto key = hashValue(converterVersion, cista::BASE_HASH);
+
+        cista::mmap source(path.c_str(), cista::mmap::protection::READ);
+        key = hashBytes({source.data(), source.size()}, key);
+
+        for (auto const &op : mConvertOps) {
+            key = cista::hash(op.name, key);
+            key = hashValue(op.type, key);
+            key = hashValue(op.format, key);
+            key = hashValue(op.encoding, key);
+        }
+
+        key = hashValue(mOptimize.has_value(), key);
+        if (mOptimize) {
+            key = hashValue(mOptimize->weldVertices, key);
+            key = hashValue(mOptimize->vertexCache, key);
+            key = hashValue(mOptimize->overdraw, key);
+            key = hashValue(mOptimize->vertexFetch, key);
+            key = hashValue(mOptimize->cacheSize, key);
+            key = hashValue(mOptimize->overdrawThreshold, key);
+        }
+
+        key = hashValue(mMeshlets.has_value(), key);
+        if (mMeshlets) {
+            key = hashValue(mMeshlets->maxVertices, key);
+            key = hashValue(mMeshlets->maxTriangles, key);
+        }
+
+        key = hashValue(mLods.has_value(), key);
+        if (mLods) {
+            key = hashValue(mLods->maxLevels, key);
+            key = hashValue(mLods->reduction, key);
+            key = hashValue(mLods->maxError, key);
+        }
+
+        return key;
+    }
+
+    MeshConverter::ConvertedMesh MeshConverter::convertSource(fs::path const &path, ThreadPool *pool) const {
+        ConvertedMesh result;
+        result.key = sourceKey(path);
+
+        if (mCache) {
+            auto cachePath = *mCache / cacheName(result.key);
+            if (fs::exists(cachePath)) {
+                cista::mmap file(cachePath.c_str(), cista::mmap::protection::READ);
+                if (auto cached = readCache(file, result.key)) {
+                    spdlog::info("Mesh {}: taken from cache {}", path.string(), cachePath.string());
+                    result.data = (*cached)->data;
+                    result.vertexCount = (*cached)->vertexCount;
+                    result.indexCount = (*cached)->indexCount;
+                    result.lods.assign((*cached)->lods.begin(), (*cached)->lods.end());
+                    result.bounds = toBounds((*cached)->bounds);
+                    result.quantization = toQuantization((*cached)->quantization);
+                    return result;
+                }
+                spdlog::warn("Ignoring damaged cache entry {}", cachePath.string());
+            }
+        }
+
+        auto &meshData = result.data;
+        auto &vertexCount = result.vertexCount;
+
+        VertexWriter writer(mConvertOps);
+        meshData = convertMesh(path, writer, vertexCount, result.indexCount);
+
+        if (mOptimize) {
+            optimizeMesh(path, meshData, writer, *mOptimize, vertexCount, pool);
+        }
+
+        auto positions = writer.decodePositions(meshData.vertices.data(), vertexCount);
+        result.bounds = computeBounds(positions);
+        result.quantization = writer.positionQuantization();
+
+        if (mMeshlets) {
+            if (positions.empty()) {
+                throw std::runtime_error("meshlets need a position attribute");
+            }
+
+            span<uint32_t const> indices(reinterpret_cast<uint32_t const *>(meshData.indices.data()),
+                    meshData.indices.size() / sizeof(uint32_t));
+            auto meshlets = buildMeshlets(indices, positions, *mMeshlets);
+            meshData.meshlets.reserve(meshlets.size());
+            for (auto const &meshlet : meshlets) {
+                meshData.meshlets.push_back(meshlet);
+            }
+            spdlog::info("Mesh {}: {} meshlets", path.string(), meshlets.size());
+        }
+
+        if (mLods) {
+            result.lods = generateLods(path, meshData, writer, *mLods,
+                    mOptimize && mOptimize->vertexCache, vertexCount);
+            result.indexCount = meshData.indices.size() / sizeof(uint32_t);
+        }
+
+        if (mCache) {
+            CachedMeshData cached = {};
+            cached.key = result.key;
+            cached.vertexCount = vertexCount;
+            cached.indexCount = result.indexCount;
+            cached.data = meshData;
+            for (auto const &lod : result.lods) {
+                cached.lods.push_back(lod);
+            }
+            cached.bounds = toBoundsData(result.bounds);
+            cached.quantization = toQuantizationData(result.quantization);
+
+            // queued copies of one source share a key, the rename keeps concurrent writers apart
+            auto cachePath = *mCache / cacheName(result.key);
+            auto tempPath = uniqueTempPath(cachePath);
+            writeFile(tempPath, cista::serialize<serializeMode>(cached));
+            fs::rename(tempPath, cachePath);
+        }
+
+        return result;
     }
 
     void MeshConverter::load(fs::path const &path, optional <string> const &dstName) {
@@ -187,36 +1102,122 @@ namespace rise {
 
         spdlog::info("Loading for converting: {}", path.string());
 
-        Size totalVertices, totalIndices;
-        auto meshData = convertMesh(path, mConvertOps, totalVertices, totalIndices);
-        spdlog::info("Total vertices {} Total indices {}", totalVertices, totalIndices);
+        auto mesh = convertSource(path, nullptr);
+        spdlog::info("Total vertices {} Total indices {}", mesh.vertexCount, mesh.indexCount);
+
+        addMesh(dstName.value_or(path.stem()), std::move(mesh));
+    }
+
+    void MeshConverter::enqueue(fs::path const &path, optional <string> const &dstName) {
+        if (!fs::exists(path)) {
+            throw FileError("File not exist: ", path);
+        }
+
+        mQueue.push_back({path, dstName.value_or(path.stem())});
+    }
+
+    void MeshConverter::loadQueued(ThreadPool &pool) {
+        spdlog::info("Loading {} meshes for converting on {} threads", mQueue.size(), pool.threadCount());
 
-        auto meshName = dstName.value_or(path.stem());
+        vector<ConvertedMesh> converted(mQueue.size());
+        pool.parallelFor(mQueue.size(), [this, &pool, &converted](Size i) {
+            spdlog::info("Loading for converting: {}", mQueue[i].path.string());
+            converted[i] = convertSource(mQueue[i].path, &pool);
+        });
 
-        mDstMeshes.emplace(meshName, meshData);
+        // indices and the mesh table are assigned in queue order to keep output deterministic
+        for (Size i = 0; i != mQueue.size(); ++i) {
+            spdlog::info("Mesh {}: total vertices {} total indices {}", mQueue[i].name,
+                    converted[i].vertexCount, converted[i].indexCount);
+            addMesh(mQueue[i].name, std::move(converted[i]));
+        }
 
+        mQueue.clear();
+    }
+
+    void MeshConverter::addMesh(string const &name, ConvertedMesh converted) {
         MeshInfoData mesh = {};
         mesh.firstIndex = currentIndex;
-        mesh.indexCount = totalIndices;
-        mesh.vertexCount = totalVertices;
+        mesh.indexCount = converted.indexCount;
+        mesh.vertexCount = converted.vertexCount;
+        mesh.meshletCount = converted.data.meshlets.size();
+        for (auto const &lod : converted.lods) {
+            mesh.lods.push_back(lod);
+        }
+        mesh.bounds = toBoundsData(converted.bounds);
+        mesh.quantization = toQuantizationData(converted.quantization);
 
-        currentIndex += totalIndices;
+        currentIndex += converted.indexCount;
 
-        mData.meshes.emplace(meshName.c_str(), mesh);
+        mMeshKeys[name] = converted.key;
+        mDstMeshes.emplace(name, std::move(converted.data));
+        mData.meshes.emplace(name.c_str(), std::move(mesh));
     }
 
-    void MeshConverter::convert(fs::path const &dst) {
+    void MeshConverter::convert(fs::path const &dst, MeshStorage storage) {
         spdlog::info("Converting to folder {}", dst.string());
 
         mData.attributes = getAttributes(mConvertOps);
 
-        cista::buf formatMap{cista::mmap{(dst / "format.rise").c_str()}};
-        cista::serialize<serializeMode>(formatMap, mData);
+        auto fitsUint16 = ranges::all_of(mData.meshes, [](auto const &mesh) {
+            return mesh.second.vertexCount <= maxUint16Vertices;
+        });
+        mData.indexType = fitsUint16 ? IndexType::Uint16 : IndexType::Uint32;
+        for (auto &mesh : mData.meshes) {
+            mesh.second.indexType = mData.indexType;
+        }
+        spdlog::info("Index type: {}", toString(mData.indexType));
+
+        auto manifest = readManifest(dst);
+        auto formatBytes = cista::serialize<serializeMode>(mData);
+        auto formatKey = hashBytes(formatBytes, hashValue(converterVersion, cista::BASE_HASH));
+
+        if (storage != MeshStorage::Files) {
+            removeOutput(dst / "format.rise", manifest);
+            vector<fs::path> meshFiles;
+            if (fs::exists(dst)) {
+                for (auto const &entry : fs::directory_iterator(dst)) {
+                    if (entry.path().extension() == ".rim") {
+                        meshFiles.push_back(entry.path());
+                    }
+                }
+            }
+            for (auto const &path : meshFiles) {
+                removeOutput(path, manifest);
+            }
 
-        for (auto const &mesh : mDstMeshes) {
-            cista::buf mmap{cista::mmap{(dst.string() + "/" + mesh.first + ".rim").c_str()}};
-            cista::serialize<serializeMode>(mmap, mesh.second);
+            auto compress = storage == MeshStorage::CompressedArchive;
+            auto archiveKey = hashValue(compress, formatKey);
+            for (auto const &[name, key] : mMeshKeys) {
+                archiveKey = hashValue(key, cista::hash(name, archiveKey));
+            }
+            writeOutput(dst / archiveName, archiveKey, manifest, [&] {
+                auto vertexSize = std::accumulate(mConvertOps.begin(), mConvertOps.end(), Size(0),
+                        [](Size size, auto const &op) { return size + formatSize(op.format); });
+                writeArchive(dst / archiveName, mData, mDstMeshes, vertexSize, compress);
+            });
+        } else {
+            // the importer prefers an archive whenever the folder has one
+            removeOutput(dst / archiveName, manifest);
+
+            writeOutput(dst / "format.rise", formatKey, manifest, [&] {
+                writeFile(dst / "format.rise", formatBytes);
+            });
+
+            for (auto const &mesh : mDstMeshes) {
+                auto path = dst / (mesh.first + ".rim");
+                writeOutput(path, hashValue(mData.indexType, mMeshKeys.at(mesh.first)), manifest, [&] {
+                    cista::buf mmap{cista::mmap{path.c_str()}};
+                    if (mData.indexType == IndexType::Uint16) {
+                        cista::serialize<serializeMode>(mmap, narrowIndices(mesh.second));
+                    } else {
+                        cista::serialize<serializeMode>(mmap, mesh.second);
+                    }
+                });
+            }
         }
+
+        writeFile(dst / manifestName, cista::serialize<serializeMode>(manifest));
     }
 
     MeshImporter::MeshImporter(fs::path const &folder, vector <string> const &meshes) {
@@ -228,63 +1229,292 @@ namespace rise {
         }
     }
 
-    void MeshDrawPlanner::draw(string_view mesh, string_view group) {
-        spdlog::info("plan draw: {}, {}", mesh.data(), group.data());
+    MeshHandle MeshDrawPlanner::mesh(string_view name) const {
+        auto mesh = mMeshIds.find(name);
+        if (mesh == mMeshIds.end()) {
+            throw std::runtime_error("mesh not found: " + string(name));
+        }
+        return {mesh->second};
+    }
 
-        auto findFormat = [this, &mesh](auto &&val) {
-            return val.name() == mMeshInfo.at(mesh.data()).format;
-        };
-        auto formatIter = ranges::find_if(mFormatGroup, findFormat);
-        if (formatIter == mFormatGroup.end()) {
-            throw std::runtime_error("mesh format not found");
+    GroupHandle MeshDrawPlanner::group(string_view name) {
+        auto group = mGroupIds.find(name);
+        if (group != mGroupIds.end()) {
+            return {group->second};
+        }
+
+        auto index = uint32_t(mGroupNames.size());
+        mGroupNames.emplace_back(name);
+        mGroupIds.emplace(name, index);
+        return {index};
+    }
+
+    void MeshDrawPlanner::draw(MeshHandle mesh, GroupHandle group, Index lod) {
+        auto const &info = mMeshes[mesh.index];
+        auto &format = mFormatGroup[info.formatGroup];
+
+        if (group.index >= format.mGroupSlots.size()) {
+            format.mGroupSlots.resize(mGroupNames.size(), noGroup);
+        }
+
+        auto &slot = format.mGroupSlots[group.index];
+        if (slot == noGroup) {
+            slot = uint32_t(format.mGroups.size());
+            auto &drawGroup = format.mGroups.emplace_back();
+            drawGroup.mName = mGroupNames[group.index];
+            drawGroup.mSlot = slot;
+        }
+
+        auto &drawGroup = format.mGroups[slot];
+        drawGroup.mMeshes.push_back(info.draws[std::min(lod, Index(info.draws.size() - 1))]);
+        drawGroup.mDirty = true;
+    }
+
+    void MeshDrawPlanner::finalize() {
+        if (mFormatGroup.size() > 0xFF || mGroupNames.size() > 0xFFFF) {
+            throw std::runtime_error("too many format groups or groups for draw sort keys");
         }
 
-        auto &drawGroups = formatIter->mGroups;
+        // key and position of the draw in its group, the position keeps equal keys in recording order
+        vector<pair<uint64_t, uint32_t>> keys;
+
+        for (Index f = 0; f != mFormatGroup.size(); ++f) {
+            auto &format = mFormatGroup[f];
+
+            for (uint32_t handle = 0; handle != format.mGroupSlots.size(); ++handle) {
+                if (format.mGroupSlots[handle] == noGroup) {
+                    continue;
+                }
+                auto &group = format.mGroups[format.mGroupSlots[handle]];
+                if (!group.mDirty) {
+                    continue;
+                }
+                group.mDirty = false;
+                ++format.mVersion;
+
+                auto &commands = group.mCommands;
+                commands.clear();
+                group.mInstanceDraws.clear();
+
+                keys.clear();
+                for (uint32_t d = 0; d != group.mMeshes.size(); ++d) {
+                    keys.emplace_back(drawKey(f, handle, group.mMeshes[d]), d);
+                }
+                ranges::sort(keys);
+
+                for (Size k = 0; k != keys.size();) {
+                    auto const &draw = group.mMeshes[keys[k].second];
+                    auto firstInstance = uint32_t(group.mInstanceDraws.size());
+
+                    auto key = keys[k].first;
+                    for (; k != keys.size() && keys[k].first == key; ++k) {
+                        group.mInstanceDraws.push_back(keys[k].second);
+                    }
+
+                    // draws of different levels or meshes never share a command, every instance
+                    // keeps its own entry in the instance draws
+                    commands.push_back({uint32_t(draw.indexCount),
+                            uint32_t(group.mInstanceDraws.size() - firstInstance), uint32_t(draw.firstIndex),
+                            int32_t(draw.vertexOffset), firstInstance});
+                }
+            }
+
+            auto back = 1 - format.mFront.index.load(std::memory_order_relaxed);
+            auto &compiled = format.mCompiled[back];
+            if (compiled.version == format.mVersion) {
+                format.mFront.index.store(back, std::memory_order_release);
+                continue;
+            }
+
+            // groups are laid out by handle so the buffer does not depend on first draw order
+            compiled.commands.clear();
+            compiled.instanceDraws.clear();
+            compiled.ranges.assign(format.mGroups.size(), {});
+            for (uint32_t handle = 0; handle != format.mGroupSlots.size(); ++handle) {
+                if (format.mGroupSlots[handle] == noGroup) {
+                    continue;
+                }
+                auto const &group = format.mGroups[format.mGroupSlots[handle]];
+                auto firstInstance = uint32_t(compiled.instanceDraws.size());
 
-        auto findDrawGroup = [&group](auto &&val) { return group == val.mName; };
-        auto groupIter = ranges::find_if(drawGroups, findDrawGroup);
+                compiled.ranges[group.mSlot] = {{handle}, Index(compiled.commands.size()), group.mCommands.size()};
+                for (auto command : group.mCommands) {
+                    command.firstInstance += firstInstance;
+                    compiled.commands.push_back(command);
+                }
+                compiled.instanceDraws.insert(compiled.instanceDraws.end(),
+                        group.mInstanceDraws.begin(), group.mInstanceDraws.end());
+            }
+            compiled.version = format.mVersion;
 
-        if (groupIter == drawGroups.end()) {
-            MeshGroup drawGroup;
-            drawGroup.mName = group;
-            drawGroups.push_back(std::move(drawGroup));
-            groupIter = --drawGroups.end();
+            format.mFront.index.store(back, std::memory_order_release);
         }
+    }
 
-        groupIter->mMeshes.push_back(mMeshInfo.at(mesh.data()).drawInfo);
+    span<DrawRecorder> MeshDrawPlanner::recorders(Size count) {
+        if (mRecorders.size() < count) {
+            mRecorders.resize(count);
+        }
+        return span(mRecorders).first(count);
+    }
+
+    void MeshDrawPlanner::merge() {
+        for (auto &recorder : mRecorders) {
+            for (auto const &draw : recorder.mDraws) {
+                assert(draw.mesh.index < mMeshes.size() && draw.group.index < mGroupNames.size());
+                this->draw(draw.mesh, draw.group, draw.lod);
+            }
+            recorder.mDraws.clear();
+        }
+    }
+
+    void MeshDrawPlanner::reset() {
+        for (auto &format : mFormatGroup) {
+            for (auto &group : format.mGroups) {
+                group.mDirty |= !group.mMeshes.empty();
+                group.mMeshes.clear();
+            }
+        }
+    }
+
+    void MeshDrawPlanner::clear(GroupHandle group) {
+        for (auto &format : mFormatGroup) {
+            if (group.index < format.mGroupSlots.size() && format.mGroupSlots[group.index] != noGroup) {
+                auto &drawGroup = format.mGroups[format.mGroupSlots[group.index]];
+                drawGroup.mDirty |= !drawGroup.mMeshes.empty();
+                drawGroup.mMeshes.clear();
+            }
+        }
+    }
+
+    Index MeshDrawPlanner::selectLod(MeshHandle mesh, float screenSize, float pixelError) const {
+        auto const &lods = mMeshes[mesh.index].lods;
+
+        Index lod = 0;
+        while (lod + 1 < lods.size() && lods[lod + 1].error * screenSize <= pixelError) {
+            ++lod;
+        }
+        return lod;
+    }
+
+    void MeshDrawPlanner::addMesh(string const &name, Index formatGroup, MeshDrawInfo const &drawInfo,
+            vector<MeshLod> lods, Bounds const &bounds, PositionQuantization const &quantization) {
+        if (lods.empty()) {
+            lods.push_back({drawInfo.firstIndex, drawInfo.indexCount});
+        }
+        // limits of the draw sort key
+        assert(lods.size() <= 0x100 && mMeshes.size() <= std::numeric_limits<uint32_t>::max());
+
+        MeshInfo info;
+        info.formatGroup = formatGroup;
+        info.bounds = bounds;
+        info.quantization = quantization;
+        for (Index lod = 0; lod != lods.size(); ++lod) {
+            auto draw = drawInfo;
+            draw.mesh = uint32_t(mMeshes.size());
+            if (lod != 0) {
+                draw.firstIndex = lods[lod].firstIndex;
+                draw.indexCount = lods[lod].indexCount;
+                draw.meshletCount = 0;
+                draw.lod = lod;
+            }
+            info.draws.push_back(draw);
+        }
+        info.lods = std::move(lods);
+
+        if (!mMeshIds.emplace(name, uint32_t(mMeshes.size())).second) {
+            spdlog::warn("Mesh {} found in several folders, the first one is used", name);
+            return;
+        }
+        mMeshes.push_back(std::move(info));
     }
 
     MeshDrawPlanner MeshImporter::load(MemData vertexData, MemData indexData) {
+        return loadFolders(vertexData, indexData, nullptr);
+    }
+
+    std::future<MeshDrawPlanner> MeshImporter::loadAsync(MemData vertexData, MemData indexData, ThreadPool &pool) {
+        return pool.async([this, vertexData, indexData, &pool] {
+            return loadFolders(vertexData, indexData, &pool);
+        });
+    }
+
+    MappedMeshes MeshImporter::mapMeshes(ThreadPool *pool) const {
+        auto start = time::steady_clock::now();
+
+        MappedMeshes mapped;
+        for (auto const &folder : mFolders) {
+            folder.mapMeshes(mapped, pool);
+        }
+
+        time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+        spdlog::info("Mapped {} meshes of {} folders in {:.2f} ms", mapped.mMeshes.size(), mFolders.size(),
+                elapsed.count());
+
+        return mapped;
+    }
+
+    MeshDrawPlanner MeshImporter::loadFolders(MemData vertexData, MemData indexData, ThreadPool *pool) {
         assert(vertexData.size >= sizeForVertices() && indexData.size >= sizeForIndices());
 
-        MeshDrawPlanner planner;
-        planner.mFormatGroup.reserve(mFolders.size());
+        auto start = time::steady_clock::now();
 
+        vector<Offset> vertexOffsets, indexOffsets;
         Offset vertexOffset = 0, indexOffset = 0;
-        for (auto &folder: mFolders) {
-            vertexData.size = folder.sizeForVertices();
-            indexData.size = folder.sizeForIndices();
+        for (auto const &folder : mFolders) {
+            vertexOffsets.push_back(vertexOffset);
+            indexOffsets.push_back(indexOffset);
+            vertexOffset += folder.sizeForVertices();
+            indexOffset += folder.sizeForIndices();
+        }
+
+        vector<FolderMeshes> folderMeshes(mFolders.size());
+        auto loadFolder = [&](Size i) {
+            auto &folder = mFolders[i];
 
-            vertexData.data = reinterpret_cast<uint8_t *>(vertexData.data) + vertexOffset;
-            indexData.data = reinterpret_cast<uint8_t *>(indexData.data) + indexOffset;
+            auto folderVertices = vertexData;
+            folderVertices.data = reinterpret_cast<uint8_t *>(vertexData.data) + vertexOffsets[i];
+            folderVertices.size = folder.sizeForVertices();
 
-            auto meshInfo = folder.load(vertexData, indexData);
+            auto folderIndices = indexData;
+            folderIndices.data = reinterpret_cast<uint8_t *>(indexData.data) + indexOffsets[i];
+            folderIndices.size = folder.sizeForIndices();
+
+            folderMeshes[i] = folder.load(folderVertices, folderIndices, pool);
+        };
+
+        if (pool) {
+            pool->parallelFor(mFolders.size(), loadFolder);
+        } else {
+            for (Size i = 0; i != mFolders.size(); ++i) {
+                loadFolder(i);
+            }
+        }
+
+        MeshDrawPlanner planner;
+        planner.mFormatGroup.reserve(mFolders.size());
+
+        for (Size i = 0; i != mFolders.size(); ++i) {
+            auto &meshInfo = folderMeshes[i];
             MeshFormatGroup formatGroup;
-            formatGroup.mName = folder.name();
+            formatGroup.mName = mFolders[i].name();
             formatGroup.mFormat = meshInfo.format;
-            formatGroup.mVertexOffset = vertexOffset;
-            formatGroup.mIndexOffset = indexOffset;
-
-            vertexOffset += vertexData.size;
-            indexOffset += indexData.size;
+            formatGroup.mVertexSize = meshInfo.vertexSize;
+            formatGroup.mVertexOffset = vertexOffsets[i];
+            formatGroup.mIndexOffset = indexOffsets[i];
+            formatGroup.mIndexType = meshInfo.indexType;
+            formatGroup.mMeshlets = std::move(meshInfo.meshlets);
 
             planner.mFormatGroup.push_back(std::move(formatGroup));
             for (auto const &p : meshInfo.meshInfo) {
-                planner.mMeshInfo.emplace(p.first,
-                        MeshDrawPlanner::MeshInfo{p.second, folder.name()});
+                planner.addMesh(p.first, i, p.second, std::move(meshInfo.lods[p.first]),
+                        meshInfo.bounds.at(p.first), meshInfo.quantization.at(p.first));
             }
         }
 
+        time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+        spdlog::info("Loaded {} mesh folders in {:.2f} ms", mFolders.size(), elapsed.count());
+
         return planner;
     }
 
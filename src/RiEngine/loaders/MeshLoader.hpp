@@ -1,5 +1,8 @@
 #pragma once
 #include "../Format.hpp"
+#include "../ThreadPool.hpp"
+#include "../StringHash.hpp"
+#include "../Culling.hpp"
 #include <cista/mmap.h>
 #include <cista/serialization.h>
 #include <glm/glm.hpp>
@@ -9,21 +12,91 @@ namespace rise {
         Position,
         Normal,
         TextCoord,
+        Color,
     };
 
+    enum class IndexType {
+        Uint16,
+        Uint32,
+    };
+
+    constexpr Size indexSize(IndexType type) {
+        return type == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
     struct VertexAttribute {
         Format format = Format::Undefined;
         Offset offset = 0;
     };
 
+    // Contiguous triangle range of a mesh bounded for cluster culling. Backfacing when
+    // dot(center - cameraPosition, coneAxis) >= coneCutoff * length(center - cameraPosition) + radius,
+    // see coneBackfacing. A cutoff above 1 never culls.
+    struct Meshlet {
+        Index firstIndex;
+        Size indexCount;
+        glm::vec3 center;
+        float radius;
+        glm::vec3 coneAxis;
+        float coneCutoff;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    // Index range of one level of detail, error is the geometric deviation from the source mesh
+    // relative to the mesh extent. Levels get coarser and their error never decreases.
+    struct MeshLod {
+        Index firstIndex;
+        Size indexCount;
+        float error = 0.f;
+    };
+
     struct MeshDrawInfo {
         Index firstIndex;
         Size indexCount;
+        // added to every index, meshes keep their indices local to their own vertices
+        Index vertexOffset = 0;
+        IndexType indexType = IndexType::Uint32;
+        // range in MeshFormatGroup::meshlets, empty when the mesh was converted without meshlets
+        Index firstMeshlet = 0;
+        Size meshletCount = 0;
+        // meshlets cover level 0 only, draws of coarser levels have no meshlets
+        Index lod = 0;
+        // MeshHandle index in the planner the draw was recorded in
+        uint32_t mesh = 0;
+    };
+
+    // Resolved once from names by MeshDrawPlanner, valid for the planner that returned them
+    struct MeshHandle {
+        uint32_t index;
+    };
+
+    struct GroupHandle {
+        uint32_t index;
+    };
+
+    // Layout of VkDrawIndexedIndirectCommand and of the OpenGL indirect elements command. Indices
+    // and vertices are relative to the index and vertex regions of the format group.
+    struct DrawIndexedIndirectCommand {
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    static_assert(sizeof(DrawIndexedIndirectCommand) == 20);
+
+    struct CommandRange {
+        GroupHandle group;
+        Index firstCommand;
+        Size commandCount;
     };
 
     class MeshGroup {
         friend class MeshDrawPlanner;
         friend class MeshImporter;
+        friend class MeshFormatGroup;
     public:
         using iterator = vector<MeshDrawInfo>::const_iterator;
 
@@ -42,6 +115,13 @@ namespace rise {
     private:
         string mName;
         vector <MeshDrawInfo> mMeshes;
+        // position in MeshFormatGroup::mGroups
+        Index mSlot = 0;
+        // draws changed since the commands of the group were built
+        bool mDirty = false;
+        // firstInstance relative to the group
+        vector<DrawIndexedIndirectCommand> mCommands;
+        vector<uint32_t> mInstanceDraws;
     };
 
     class MeshFormatGroup {
@@ -66,6 +146,15 @@ namespace rise {
             return mFormat.contains(name.data());
         }
 
+        map<string, VertexAttribute> const &attributes() const {
+            return mFormat;
+        }
+
+        // Stride of the interleaved vertices
+        Size vertexSize() const {
+            return mVertexSize;
+        }
+
         Offset vertexOffset() const {
             return mVertexOffset;
         }
@@ -74,6 +163,48 @@ namespace rise {
             return mIndexOffset;
         }
 
+        IndexType indexType() const {
+            return mIndexType;
+        }
+
+        span<Meshlet const> meshlets() const {
+            return mMeshlets;
+        }
+
+        span<Meshlet const> meshlets(MeshDrawInfo const &mesh) const {
+            return meshlets().subspan(mesh.firstMeshlet, mesh.meshletCount);
+        }
+
+        // One multi draw indirect buffer for the whole format group, every group owns a range of it.
+        // Commands come from the last finalize and may be read while the next frame is recorded.
+        span<DrawIndexedIndirectCommand const> commands() const {
+            return front().commands;
+        }
+
+        span<CommandRange const> commandRanges() const {
+            return front().ranges;
+        }
+
+        span<DrawIndexedIndirectCommand const> commands(MeshGroup const &group) const {
+            auto const &ranges = front().ranges;
+            if (group.mSlot >= ranges.size()) {
+                return {};
+            }
+            return commands().subspan(ranges[group.mSlot].firstCommand, ranges[group.mSlot].commandCount);
+        }
+
+        // For every instance id the position of its draw in the recorded draws of its group, per
+        // instance data laid out in this order is indexed by the instance index
+        span<uint32_t const> instanceDraws() const {
+            return front().instanceDraws;
+        }
+
+        // Changes whenever finalize produced different commands, an uploaded copy with the same
+        // version is still valid
+        uint64_t commandsVersion() const {
+            return front().version;
+        }
+
         string_view name() const {
             return mName;
         }
@@ -82,19 +213,176 @@ namespace rise {
         string mName;
         vector <MeshGroup> mGroups;
         map <string, VertexAttribute> mFormat;
+        Size mVertexSize = 0;
         Offset mVertexOffset = 0;
         Offset mIndexOffset = 0;
+        IndexType mIndexType = IndexType::Uint32;
+        vector<Meshlet> mMeshlets;
+        struct CompiledCommands {
+            vector<DrawIndexedIndirectCommand> commands;
+            vector<uint32_t> instanceDraws;
+            // by group slot
+            vector<CommandRange> ranges;
+            uint64_t version = 0;
+        };
+
+        CompiledCommands const &front() const {
+            return mCompiled[mFront.index.load(std::memory_order_acquire)];
+        }
+
+        // position in mGroups by group handle, noGroup when nothing was drawn in the group yet
+        vector<uint32_t> mGroupSlots;
+        // finalize builds the back buffer while the front one is read
+        std::array<CompiledCommands, 2> mCompiled;
+        // atomic index of the front buffer, moves are only done before readers see the group
+        struct FrontIndex {
+            std::atomic<Index> index = 0;
+
+            FrontIndex() = default;
+
+            FrontIndex(FrontIndex &&other) noexcept : index(other.index.load(std::memory_order_relaxed)) {}
+
+            FrontIndex &operator=(FrontIndex &&other) noexcept {
+                index.store(other.index.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+        };
+
+        FrontIndex mFront;
+        uint64_t mVersion = 0;
+    };
+
+    enum class MeshStorage {
+        // format.rise and one .rim file per mesh
+        Files,
+        // a single meshes.pack holding the format table, a mesh directory and the vertex and index blobs
+        Archive,
+        // meshes.pack with blobs split into compressed chunks decoded in parallel on load, cannot be mapped
+        CompressedArchive,
+    };
+
+    struct MeshletOptions {
+        Size maxVertices = 64;
+        Size maxTriangles = 124;
+    };
+
+    struct LodOptions {
+        // including the source mesh as level 0
+        Size maxLevels = 4;
+        // triangle count of a level relative to the previous one
+        float reduction = 0.5f;
+        // simplification stops at this deviation relative to the mesh extent
+        float maxError = 0.05f;
+    };
+
+    enum class AttributeEncoding {
+        // attribute values written as they are
+        Direct,
+        // positions mapped into the mesh bounds, so normalized formats cover the whole mesh
+        BoundsRelative,
+        // unit normals folded onto an octahedron, two components
+        Octahedral,
     };
 
     struct MeshConvertOp {
         string name;
         MeshAttribute type;
         Format format;
+        AttributeEncoding encoding = AttributeEncoding::Direct;
+    };
+
+    enum class QuantizationPreset {
+        // 16 bytes, 16 bit positions and normals, half float texture coordinates
+        Quality,
+        // 14 bytes, 16 bit positions, 8 bit normals, half float texture coordinates, every attribute
+        // offset is a multiple of its component size
+        Compact,
+    };
+
+    // Convert ops named inPositions, inNormals and inTextCoords
+    vector<MeshConvertOp> quantizedOps(QuantizationPreset preset);
+
+    // Mesh space position of a bounds relative vertex is decoded * scale + offset
+    struct PositionQuantization {
+        glm::vec3 scale = glm::vec3(1.f);
+        glm::vec3 offset = glm::vec3(0.f);
+    };
+
+    struct MeshOptimizeOptions {
+        // merges vertices that became equal after packing into their formats
+        bool weldVertices = true;
+        bool vertexCache = true;
+        bool overdraw = true;
+        bool vertexFetch = true;
+        Size cacheSize = 16;
+        // how much vertex cache efficiency overdraw ordering may give up
+        float overdrawThreshold = 1.05f;
     };
 
     struct FolderMeshes {
         map<string, MeshDrawInfo> meshInfo;
         map<string, VertexAttribute> format;
+        Size vertexSize = 0;
+        IndexType indexType = IndexType::Uint32;
+        vector<Meshlet> meshlets;
+        map<string, vector<MeshLod>> lods;
+        map<string, Bounds> bounds;
+        map<string, PositionQuantization> quantization;
+    };
+
+    // Views of a mesh straight into the mapped files. Index ranges of meshlets and lods are
+    // relative to the indices of the mesh and indices are relative to its vertices.
+    struct MappedMesh {
+        span<std::byte const> vertices;
+        span<std::byte const> indices;
+        Index formatGroup = 0;
+        vector<Meshlet> meshlets;
+        vector<MeshLod> lods;
+        Bounds bounds = Bounds::infinite();
+        PositionQuantization quantization;
+    };
+
+    struct MappedFormatGroup {
+        string name;
+        map<string, VertexAttribute> format;
+        Size vertexSize = 0;
+        IndexType indexType = IndexType::Uint32;
+        // whole vertex and index blobs of an archive, empty for folders stored as .rim files
+        span<std::byte const> vertices;
+        span<std::byte const> indices;
+    };
+
+    namespace util {
+        class MeshFolderImporter;
+    }
+
+    // Owns the file mappings, every view stays valid while the handle lives
+    class MappedMeshes : NonCopyable {
+        friend class MeshImporter;
+        friend class util::MeshFolderImporter;
+    public:
+        using iterator = vector<MappedFormatGroup>::const_iterator;
+
+        iterator begin() const {
+            return mGroups.begin();
+        }
+
+        iterator end() const {
+            return mGroups.end();
+        }
+
+        MappedMesh const &mesh(string_view name) const {
+            return mMeshes.at(name.data());
+        }
+
+        MappedFormatGroup const &formatGroup(MappedMesh const &mesh) const {
+            return mGroups[mesh.formatGroup];
+        }
+
+    private:
+        vector<std::shared_ptr<cista::mmap>> mMappings;
+        vector<MappedFormatGroup> mGroups;
+        map<string, MappedMesh> mMeshes;
     };
 
     namespace util {
@@ -105,27 +393,114 @@ namespace rise {
             uint64_t offset;
         };
 
+        struct LodData {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float error;
+        };
+
+        struct BoundsData {
+            cista::array<float, 3> min;
+            cista::array<float, 3> max;
+            cista::array<float, 3> center;
+            float radius;
+        };
+
+        struct PositionQuantizationData {
+            cista::array<float, 3> scale;
+            cista::array<float, 3> offset;
+        };
+
         struct MeshInfoData {
             uint32_t firstIndex;
+            // all levels, they follow each other in the index data of the mesh
             uint32_t indexCount;
             uint32_t vertexCount;
+            IndexType indexType;
+            uint32_t meshletCount;
+            // empty when the mesh was converted without LODs
+            binary::vector<LodData> lods;
+            BoundsData bounds;
+            PositionQuantizationData quantization;
         };
 
         struct VertexFormatData {
             binary::hash_map<binary::string, VertexAttributeData> attributes;
             binary::hash_map<binary::string, MeshInfoData> meshes;
+            IndexType indexType;
+        };
+
+        struct MeshletData {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            cista::array<float, 3> center;
+            float radius;
+            cista::array<float, 3> coneAxis;
+            float coneCutoff;
+            cista::array<float, 3> boundsMin;
+            cista::array<float, 3> boundsMax;
         };
 
         struct MeshData {
             binary::vector<uint8_t> vertices;
             binary::vector<uint8_t> indices;
+            binary::vector<MeshletData> meshlets;
+        };
+
+        // converted mesh as stored in the conversion cache, key covers everything the conversion read
+        struct CachedMeshData {
+            uint64_t key;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            MeshData data;
+            binary::vector<LodData> lods;
+            BoundsData bounds;
+            PositionQuantizationData quantization;
+        };
+
+        // input keys of the files last written to a destination folder
+        struct OutputManifestData {
+            binary::hash_map<binary::string, uint64_t> outputs;
+        };
+
+        // byte ranges are relative to the vertex and index blobs of the archive, in compressed
+        // archives they are ranges of the decoded blobs and the chunks locate the stored data
+        struct ArchiveMeshData {
+            uint64_t vertexOffset;
+            uint64_t vertexSize;
+            uint64_t indexOffset;
+            uint64_t indexSize;
+            uint32_t firstMeshlet;
+            uint32_t meshletCount;
+            uint32_t firstVertexChunk;
+            uint32_t vertexChunkCount;
+            uint32_t firstIndexChunk;
+            uint32_t indexChunkCount;
+        };
+
+        // independently compressed piece of a mesh, offset is relative to the stored blob
+        struct ArchiveChunkData {
+            uint64_t offset;
+            uint64_t storedSize;
+            uint64_t size;
+        };
+
+        struct MeshArchiveTable {
+            VertexFormatData format;
+            binary::hash_map<binary::string, ArchiveMeshData> directory;
+            binary::vector<MeshletData> meshlets;
+            // empty for uncompressed archives
+            binary::vector<ArchiveChunkData> chunks;
         };
 
         class MeshFolderImporter : NonCopyable {
         public:
             explicit MeshFolderImporter(fs::path const &workingDirectory, vector<string> const& meshes);
 
-            FolderMeshes load(MemData vertexData, MemData indexData);
+            // With a pool meshes are copied in parallel, every mesh has a precomputed destination
+            FolderMeshes load(MemData vertexData, MemData indexData, ThreadPool *pool = nullptr);
+
+            void mapMeshes(MappedMeshes &mapped, ThreadPool *pool = nullptr) const;
 
             Size sizeForVertices() const {
                 return mSizeForVertices;
@@ -140,8 +515,22 @@ namespace rise {
             }
 
         private:
+            void loadFiles(MemData vertexData, MemData indexData, ThreadPool *pool,
+                    vector<vector<Meshlet>> &meshlets) const;
+
+            void loadArchive(MemData vertexData, MemData indexData, ThreadPool *pool,
+                    vector<vector<Meshlet>> &meshlets) const;
+
+            bool compressedArchive() const {
+                return mArchiveTable && !mArchiveTable->chunks.empty();
+            }
+
             fs::path mFolder;
             FolderMeshes mMeshes;
+            // set when the folder is a packed archive, the table points into the mapping
+            std::shared_ptr<cista::mmap> mArchive;
+            MeshArchiveTable const *mArchiveTable = nullptr;
+            Size mVertexSize = 0;
             Size mSizeForVertices = 0;
             Size mSizeForIndices = 0;
         };
@@ -158,20 +547,159 @@ namespace rise {
             mConvertOps.push_back(op);
         }
 
+        // Reorders triangles and vertices of every mesh loaded after this call
+        void setOptimization(MeshOptimizeOptions const& options) {
+            mOptimize = options;
+        }
+
+        // Splits every mesh loaded after this call into meshlets
+        void setMeshlets(MeshletOptions const& options) {
+            mMeshlets = options;
+        }
+
+        // Appends simplified levels of detail to every mesh loaded after this call
+        void setLods(LodOptions const& options) {
+            mLods = options;
+        }
+
+        // Reuses converted meshes whose source bytes, convert ops and options are unchanged. Keep the
+        // cache folder outside of mesh import folders.
+        void setCache(fs::path const& folder);
+
         void load(fs::path const &path, optional<string> const& dstName = {});
 
-        void convert(fs::path const &dst);
+        // Queued meshes are converted by loadQueued, the result does not depend on thread count
+        void enqueue(fs::path const &path, optional<string> const& dstName = {});
+
+        void loadQueued(ThreadPool &pool);
+
+        void convert(fs::path const &dst, MeshStorage storage = MeshStorage::Files);
     private:
+        struct QueuedMesh {
+            fs::path path;
+            string name;
+        };
+
+        struct ConvertedMesh {
+            util::MeshData data;
+            Size vertexCount = 0;
+            Size indexCount = 0;
+            vector<util::LodData> lods;
+            Bounds bounds = Bounds::infinite();
+            PositionQuantization quantization;
+            uint64_t key = 0;
+        };
+
+        uint64_t sourceKey(fs::path const &path) const;
+
+        ConvertedMesh convertSource(fs::path const &path, ThreadPool *pool) const;
+
+        void addMesh(string const &name, ConvertedMesh mesh);
+
         util::VertexFormatData mData;
         map <string, util::MeshData> mDstMeshes;
+        map <string, uint64_t> mMeshKeys;
         vector<MeshConvertOp> mConvertOps;
+        vector<QueuedMesh> mQueue;
+        optional<MeshOptimizeOptions> mOptimize;
+        optional<MeshletOptions> mMeshlets;
+        optional<LodOptions> mLods;
+        optional<fs::path> mCache;
         Index currentIndex = 0;
     };
     
+    // Appends draws without touching the planner, one recorder is used by one thread at a time
+    class DrawRecorder {
+        friend class MeshDrawPlanner;
+    public:
+        void draw(MeshHandle mesh, GroupHandle group, Index lod = 0) {
+            mDraws.push_back({mesh, group, lod});
+        }
+
+        Size size() const {
+            return mDraws.size();
+        }
+
+    private:
+        struct Draw {
+            MeshHandle mesh;
+            GroupHandle group;
+            Index lod;
+        };
+
+        vector<Draw> mDraws;
+    };
+
     class MeshDrawPlanner : NonCopyable {
         friend class MeshImporter;
     public:
-        void draw(string_view mesh, string_view group);
+        // Throws when the mesh was not imported
+        MeshHandle mesh(string_view name) const;
+
+        // Groups are created on first use
+        GroupHandle group(string_view name);
+
+        // Allocation-free once every group was drawn into and has grown to its usual size
+        void draw(MeshHandle mesh, GroupHandle group, Index lod = 0);
+
+        void draw(string_view mesh, string_view group, Index lod = 0) {
+            draw(this->mesh(mesh), this->group(group), lod);
+        }
+
+        // Local bounds for culling instances before they are drawn
+        Bounds const &bounds(MeshHandle mesh) const {
+            return mMeshes[mesh.index].bounds;
+        }
+
+        // Shaders of bounds relative positions apply this to get mesh space positions
+        PositionQuantization const &positionQuantization(MeshHandle mesh) const {
+            return mMeshes[mesh.index].quantization;
+        }
+
+        Size lodCount(MeshHandle mesh) const {
+            return mMeshes[mesh.index].lods.size();
+        }
+
+        Size lodCount(string_view mesh) const {
+            return lodCount(this->mesh(mesh));
+        }
+
+        // Coarsest level whose error stays under pixelError when the mesh extent covers screenSize pixels
+        Index selectLod(MeshHandle mesh, float screenSize, float pixelError = 1.f) const;
+
+        // Position of the format group of the mesh in planner iteration order
+        Index formatGroup(MeshHandle mesh) const {
+            return mMeshes[mesh.index].formatGroup;
+        }
+
+        Index selectLod(string_view mesh, float screenSize, float pixelError = 1.f) const {
+            return selectLod(this->mesh(mesh), screenSize, pixelError);
+        }
+
+        // Builds indirect commands of every format group after the last draw. Draws are sorted by
+        // format, group, mesh and level and repeated draws become instances of one command.
+        // Only groups drawn into or cleared since the last call are rebuilt. Commands are double
+        // buffered, readers must be done with a frame before the second following finalize.
+        void finalize();
+
+        // Recorders for parallel recording, created on first request and kept with their memory.
+        // Resolve mesh and group handles before recording, group() is not thread safe.
+        span<DrawRecorder> recorders(Size count);
+
+        // Draws of the recorders in recorder order, then empties them. Recording the same work into
+        // the same recorder index, for example one recorder per parallelFor index, gives the same
+        // plan for any thread count.
+        void merge();
+
+        // Drops the draws of every group, memory is kept for the next frame
+        void reset();
+
+        // Drops the draws of one group, other groups keep their draws and built commands
+        void clear(GroupHandle group);
+
+        string_view groupName(GroupHandle group) const {
+            return mGroupNames[group.index];
+        }
 
         using iterator = vector<MeshFormatGroup>::const_iterator;
 
@@ -184,12 +712,27 @@ namespace rise {
         }
 
     private:
+        static constexpr uint32_t noGroup = std::numeric_limits<uint32_t>::max();
+
         struct MeshInfo {
-            MeshDrawInfo drawInfo;
-            string format;
+            Index formatGroup;
+            vector<MeshLod> lods;
+            // ready to push draw info of every level
+            vector<MeshDrawInfo> draws;
+            Bounds bounds;
+            PositionQuantization quantization;
         };
+
+        void addMesh(string const &name, Index formatGroup, MeshDrawInfo const &drawInfo, vector<MeshLod> lods,
+                Bounds const &bounds, PositionQuantization const &quantization);
+
         vector<MeshFormatGroup> mFormatGroup;
-        map<string, MeshInfo> mMeshInfo;
+        vector<MeshInfo> mMeshes;
+        vector<DrawRecorder> mRecorders;
+        StringMap<uint32_t> mMeshIds;
+        // deque keeps names in place for views held by readers
+        deque<string> mGroupNames;
+        StringMap<uint32_t> mGroupIds;
     };
 
     class MeshImporter : NonCopyable {
@@ -199,11 +742,19 @@ namespace rise {
         // IMPORTANT: Not use this class after load call, mesh data will be moved!
         MeshDrawPlanner load(MemData vertexData, MemData indexData);
 
+        // Loads folders and meshes on the pool. The importer and both buffers must outlive the future
+        std::future<MeshDrawPlanner> loadAsync(MemData vertexData, MemData indexData, ThreadPool &pool);
+
+        // Maps the meshes without copying them, the importer may be dropped afterwards
+        MappedMeshes mapMeshes(ThreadPool *pool = nullptr) const;
+
         Size sizeForVertices() const;
 
         Size sizeForIndices() const;
 
     private:
+        MeshDrawPlanner loadFolders(MemData vertexData, MemData indexData, ThreadPool *pool);
+
         vector <util::MeshFolderImporter> mFolders;
     };
 }
\ No newline at end of file
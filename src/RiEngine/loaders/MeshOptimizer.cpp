@@ -0,0 +1,721 @@
+#include "MeshOptimizer.hpp"
+#include <cista/hash.h>
+
+namespace rise::util {
+    namespace {
+        constexpr Size forsythCacheSize = 32;
+        constexpr float lastTriangleScore = 0.75f;
+        constexpr float cacheDecayPower = 1.5f;
+        constexpr float valenceBoostScale = 2.f;
+        constexpr float valenceBoostPower = 0.5f;
+        constexpr Size noTriangle = ~Size(0);
+
+        float vertexScore(int cachePosition, Size liveTriangles) {
+            if (liveTriangles == 0) {
+                return -1.f;
+            }
+
+            float score = 0.f;
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    score = lastTriangleScore;
+                } else {
+                    auto scale = 1.f / float(forsythCacheSize - 3);
+                    score = std::pow(1.f - float(cachePosition - 3) * scale, cacheDecayPower);
+                }
+            }
+
+            return score + valenceBoostScale * std::pow(float(liveTriangles), -valenceBoostPower);
+        }
+
+        // first-in first-out cache as the post transform cache of most hardware behaves
+        class FifoCache {
+        public:
+            FifoCache(Size vertexCount, Size cacheSize) : mTimestamps(vertexCount, 0), mSize(cacheSize) {}
+
+            bool access(uint32_t vertex) {
+                if (mTime - mTimestamps[vertex] < mSize && mTimestamps[vertex] != 0) {
+                    return false;
+                }
+                mTimestamps[vertex] = ++mTime;
+                return true;
+            }
+
+            void reset() {
+                mTime += mSize + 1;
+            }
+
+        private:
+            vector<Size> mTimestamps;
+            Size mTime = 0;
+            Size mSize;
+        };
+
+        // plane distance quadric, symmetric 4x4 matrix stored as its upper triangle
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+            double a11 = 0, a12 = 0, a13 = 0;
+            double a22 = 0, a23 = 0;
+            double a33 = 0;
+
+            static Quadric plane(double x, double y, double z, double d) {
+                return {x * x, x * y, x * z, x * d, y * y, y * z, y * d, z * z, z * d, d * d};
+            }
+
+            Quadric &operator+=(Quadric const &other) {
+                a00 += other.a00, a01 += other.a01, a02 += other.a02, a03 += other.a03;
+                a11 += other.a11, a12 += other.a12, a13 += other.a13;
+                a22 += other.a22, a23 += other.a23;
+                a33 += other.a33;
+                return *this;
+            }
+
+            double error(glm::vec3 const &p) const {
+                double x = p.x, y = p.y, z = p.z;
+                return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                        + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                        + a22 * z * z + 2 * a23 * z + a33;
+            }
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        uint64_t edgeKey(uint32_t a, uint32_t b) {
+            return uint64_t(std::min(a, b)) << 32u | std::max(a, b);
+        }
+
+        vector<bool> lockedVertices(span<uint32_t const> indices, span<glm::vec3 const> positions) {
+            vector<bool> locked(positions.size(), false);
+
+            // vertices sharing a position with another vertex sit on an attribute seam
+            vector<uint32_t> order(positions.size());
+            std::iota(order.begin(), order.end(), 0);
+            auto byPosition = [&](uint32_t a, uint32_t b) {
+                auto const &pa = positions[a], &pb = positions[b];
+                return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+            };
+            ranges::sort(order, byPosition);
+            for (Size i = 1; i < order.size(); ++i) {
+                if (positions[order[i]] == positions[order[i - 1]]) {
+                    locked[order[i]] = locked[order[i - 1]] = true;
+                }
+            }
+
+            // edges used by a single triangle are the open border
+            std::unordered_map<uint64_t, Size> edges;
+            for (Size i = 0; i < indices.size(); i += 3) {
+                for (Size k = 0; k != 3; ++k) {
+                    ++edges[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+                }
+            }
+            for (auto const &[key, count] : edges) {
+                if (count == 1) {
+                    locked[key >> 32u] = locked[key & 0xFFFFFFFFu] = true;
+                }
+            }
+
+            return locked;
+        }
+
+        struct Cluster {
+            Size first;
+            Size end;
+            float sortKey = 0.f;
+        };
+
+        vector<Size> hardBoundaries(span<uint32_t const> indices, Size vertexCount, Size cacheSize) {
+            vector<Size> result;
+            FifoCache cache(vertexCount, cacheSize);
+
+            for (Size t = 0; t < indices.size() / 3; ++t) {
+                Size misses = 0;
+                for (Size k = 0; k != 3; ++k) {
+                    misses += cache.access(indices[t * 3 + k]);
+                }
+                // a triangle that misses on every vertex starts from scratch anyway
+                if (misses == 3) {
+                    result.push_back(t);
+                }
+            }
+
+            if (result.empty() || result.front() != 0) {
+                result.insert(result.begin(), 0);
+            }
+            return result;
+        }
+
+        vector<Size> softBoundaries(span<uint32_t const> indices, Size vertexCount, Size cacheSize,
+                vector<Size> const &hard, float threshold) {
+            constexpr Size minClusterTriangles = 8;
+
+            vector<Size> result;
+            FifoCache cache(vertexCount, cacheSize);
+            auto triangleCount = indices.size() / 3;
+
+            for (Size c = 0; c != hard.size(); ++c) {
+                auto first = hard[c];
+                auto end = c + 1 == hard.size() ? triangleCount : hard[c + 1];
+
+                cache.reset();
+                Size clusterMisses = 0;
+                for (auto t = first; t != end; ++t) {
+                    for (Size k = 0; k != 3; ++k) {
+                        clusterMisses += cache.access(indices[t * 3 + k]);
+                    }
+                }
+                auto target = float(clusterMisses) / float(end - first) * threshold;
+
+                cache.reset();
+                result.push_back(first);
+                Size start = first, misses = 0;
+                for (auto t = first; t != end; ++t) {
+                    for (Size k = 0; k != 3; ++k) {
+                        misses += cache.access(indices[t * 3 + k]);
+                    }
+
+                    auto triangles = t + 1 - start;
+                    if (t + 1 != end && triangles >= minClusterTriangles
+                            && float(misses) / float(triangles) <= target) {
+                        result.push_back(t + 1);
+                        start = t + 1;
+                        misses = 0;
+                        cache.reset();
+                    }
+                }
+            }
+
+            return result;
+        }
+    }
+
+    Size weldVertices(span<uint32_t> indices, span<uint8_t> vertices, Size vertexSize, ThreadPool *pool) {
+        constexpr Size parallelVertices = 1 << 16;
+        constexpr Size grain = 1 << 14;
+
+        auto vertexCount = vertices.size() / vertexSize;
+        if (vertexCount < parallelVertices) {
+            pool = nullptr;
+        }
+
+        auto forEach = [pool](Size count, auto &&body) {
+            if (pool) {
+                pool->parallelFor((count + grain - 1) / grain, [&](Size chunk) {
+                    for (auto i = chunk * grain; i != std::min(count, (chunk + 1) * grain); ++i) {
+                        body(i);
+                    }
+                });
+            } else {
+                for (Size i = 0; i != count; ++i) {
+                    body(i);
+                }
+            }
+        };
+
+        auto vertex = [&](Size v) {
+            return vertices.data() + v * vertexSize;
+        };
+
+        vector<uint64_t> hashes(vertexCount);
+        forEach(vertexCount, [&](Size v) {
+            hashes[v] = cista::hash(string_view(reinterpret_cast<char const *>(vertex(v)), vertexSize));
+        });
+
+        // equal vertices have equal hashes, so every shard dedups its own vertices independently
+        // and always keeps the lowest index as canonical, whatever the thread count is
+        auto shardCount = pool ? pool->threadCount() * 4 : 1;
+        vector<uint32_t> canonical(vertexCount);
+        forEach(shardCount, [&](Size shard) {
+            std::unordered_multimap<uint64_t, uint32_t> seen;
+            for (Size v = 0; v != vertexCount; ++v) {
+                if (hashes[v] % shardCount != shard) {
+                    continue;
+                }
+
+                canonical[v] = uint32_t(v);
+                auto [first, last] = seen.equal_range(hashes[v]);
+                for (auto it = first; it != last; ++it) {
+                    if (memcmp(vertex(it->second), vertex(v), vertexSize) == 0) {
+                        canonical[v] = it->second;
+                        break;
+                    }
+                }
+                if (canonical[v] == v) {
+                    seen.emplace(hashes[v], uint32_t(v));
+                }
+            }
+        });
+
+        vector<uint32_t> remap(vertexCount);
+        uint32_t nextVertex = 0;
+        for (Size v = 0; v != vertexCount; ++v) {
+            if (canonical[v] == v) {
+                if (nextVertex != v) {
+                    memcpy(vertex(nextVertex), vertex(v), vertexSize);
+                }
+                remap[v] = nextVertex++;
+            } else {
+                remap[v] = remap[canonical[v]];
+            }
+        }
+
+        forEach(indices.size(), [&](Size i) {
+            indices[i] = remap[indices[i]];
+        });
+
+        return nextVertex;
+    }
+
+    VertexCacheStats analyzeVertexCache(span<uint32_t const> indices, Size vertexCount, Size cacheSize) {
+        VertexCacheStats stats;
+        if (indices.empty()) {
+            return stats;
+        }
+
+        FifoCache cache(vertexCount, cacheSize);
+        vector<bool> used(vertexCount, false);
+        Size misses = 0, usedVertices = 0;
+
+        for (auto index : indices) {
+            misses += cache.access(index);
+            if (!used[index]) {
+                used[index] = true;
+                ++usedVertices;
+            }
+        }
+
+        stats.acmr = float(misses) / float(indices.size() / 3);
+        stats.atvr = float(misses) / float(usedVertices);
+        return stats;
+    }
+
+    void optimizeVertexCache(span<uint32_t> indices, Size vertexCount) {
+        auto triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // triangles adjacent to every vertex, packed one vertex after another
+        vector<Size> liveTriangles(vertexCount, 0);
+        for (auto index : indices) {
+            ++liveTriangles[index];
+        }
+
+        vector<Size> adjacencyOffset(vertexCount + 1, 0);
+        for (Size v = 0; v != vertexCount; ++v) {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+        }
+
+        vector<Size> adjacency(indices.size());
+        vector<Size> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (Size i = 0; i != indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        vector<int> cachePosition(vertexCount, -1);
+        vector<float> score(vertexCount);
+        for (Size v = 0; v != vertexCount; ++v) {
+            score[v] = vertexScore(-1, liveTriangles[v]);
+        }
+
+        vector<bool> emitted(triangleCount, false);
+
+        vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        vector<uint32_t> cache, nextCache;
+        cache.reserve(forsythCacheSize + 3);
+        nextCache.reserve(forsythCacheSize + 3);
+
+        Size input = 0;
+        auto best = noTriangle;
+
+        while (result.size() != indices.size()) {
+            if (best == noTriangle) {
+                while (emitted[input]) {
+                    ++input;
+                }
+                best = input;
+            }
+
+            emitted[best] = true;
+            uint32_t const *triangle = &indices[best * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+
+            // new triangle goes to the front of the cache, the rest keeps its order
+            nextCache.assign(triangle, triangle + 3);
+            for (auto vertex : cache) {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                    nextCache.push_back(vertex);
+                }
+            }
+
+            for (Size k = 0; k != 3; ++k) {
+                auto vertex = triangle[k];
+                auto first = adjacency.begin() + adjacencyOffset[vertex];
+                auto last = first + liveTriangles[vertex];
+                std::iter_swap(std::find(first, last, best), last - 1);
+                --liveTriangles[vertex];
+            }
+
+            for (Size i = 0; i != nextCache.size(); ++i) {
+                auto vertex = nextCache[i];
+                cachePosition[vertex] = i < forsythCacheSize ? int(i) : -1;
+                score[vertex] = vertexScore(cachePosition[vertex], liveTriangles[vertex]);
+            }
+
+            best = noTriangle;
+            auto bestScore = -1.f;
+            for (Size i = 0; i != nextCache.size(); ++i) {
+                auto vertex = nextCache[i];
+                auto first = adjacencyOffset[vertex];
+                for (auto a = first; a != first + liveTriangles[vertex]; ++a) {
+                    auto t = adjacency[a];
+                    auto triangleScore = score[indices[t * 3]] + score[indices[t * 3 + 1]]
+                            + score[indices[t * 3 + 2]];
+                    if (triangleScore > bestScore) {
+                        bestScore = triangleScore;
+                        best = t;
+                    }
+                }
+            }
+
+            if (nextCache.size() > forsythCacheSize) {
+                nextCache.resize(forsythCacheSize);
+            }
+            std::swap(cache, nextCache);
+        }
+
+        ranges::copy(result, indices.begin());
+    }
+
+    void optimizeOverdraw(span<uint32_t> indices, span<glm::vec3 const> positions, Size cacheSize,
+            float threshold) {
+        auto triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        auto hard = hardBoundaries(indices, positions.size(), cacheSize);
+        auto soft = softBoundaries(indices, positions.size(), cacheSize, hard, threshold);
+
+        glm::vec3 meshCentroid(0.f);
+        for (auto index : indices) {
+            meshCentroid += positions[index];
+        }
+        meshCentroid /= float(indices.size());
+
+        vector<Cluster> clusters;
+        clusters.reserve(soft.size());
+        for (Size i = 0; i != soft.size(); ++i) {
+            Cluster cluster{soft[i], i + 1 == soft.size() ? triangleCount : soft[i + 1]};
+
+            glm::vec3 centroid(0.f), normal(0.f);
+            float area = 0.f;
+            for (auto t = cluster.first; t != cluster.end; ++t) {
+                auto const &a = positions[indices[t * 3]];
+                auto const &b = positions[indices[t * 3 + 1]];
+                auto const &c = positions[indices[t * 3 + 2]];
+
+                auto weightedNormal = glm::cross(b - a, c - a);
+                auto triangleArea = glm::length(weightedNormal);
+
+                centroid += (a + b + c) * (triangleArea / 3.f);
+                normal += weightedNormal;
+                area += triangleArea;
+            }
+
+            if (area > 0.f) {
+                centroid /= area;
+                auto normalLength = glm::length(normal);
+                if (normalLength > 0.f) {
+                    cluster.sortKey = glm::dot(centroid - meshCentroid, normal / normalLength);
+                }
+            }
+            clusters.push_back(cluster);
+        }
+
+        // clusters facing out of the mesh occlude the rest, draw them first
+        ranges::stable_sort(clusters, std::greater<>(), &Cluster::sortKey);
+
+        vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (auto const &cluster : clusters) {
+            result.insert(result.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+        }
+        ranges::copy(result, indices.begin());
+    }
+
+    Size optimizeVertexFetch(span<uint32_t> indices, span<uint8_t> vertices, Size vertexSize) {
+        constexpr auto unused = ~uint32_t(0);
+
+        auto vertexCount = vertices.size() / vertexSize;
+        vector<uint32_t> remap(vertexCount, unused);
+        uint32_t nextVertex = 0;
+
+        for (auto &index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+
+        vector<uint8_t> reordered(Size(nextVertex) * vertexSize);
+        for (Size v = 0; v != vertexCount; ++v) {
+            if (remap[v] != unused) {
+                memcpy(reordered.data() + remap[v] * vertexSize, vertices.data() + v * vertexSize, vertexSize);
+            }
+        }
+        ranges::copy(reordered, vertices.begin());
+
+        return nextVertex;
+    }
+
+    vector<MeshletData> buildMeshlets(span<uint32_t const> indices, span<glm::vec3 const> positions,
+            MeshletOptions const &options) {
+        vector<MeshletData> result;
+        vector<Size> stamp(positions.size(), ~Size(0));
+
+        auto finish = [&](Size first, Size end) {
+            MeshletData meshlet = {};
+            meshlet.firstIndex = uint32_t(first * 3);
+            meshlet.indexCount = uint32_t((end - first) * 3);
+
+            glm::vec3 low(std::numeric_limits<float>::max()), high(std::numeric_limits<float>::lowest());
+            glm::vec3 normalSum(0.f);
+            vector<glm::vec3> normals;
+            normals.reserve(end - first);
+
+            for (auto t = first; t != end; ++t) {
+                auto const &a = positions[indices[t * 3]];
+                auto const &b = positions[indices[t * 3 + 1]];
+                auto const &c = positions[indices[t * 3 + 2]];
+                for (auto const *p : {&a, &b, &c}) {
+                    low = glm::min(low, *p);
+                    high = glm::max(high, *p);
+                }
+
+                auto normal = glm::cross(b - a, c - a);
+                auto length = glm::length(normal);
+                if (length > 0.f) {
+                    normals.push_back(normal / length);
+                    normalSum += normal / length;
+                }
+            }
+
+            auto center = (low + high) * 0.5f;
+            float radius = 0.f;
+            for (auto i = first * 3; i != end * 3; ++i) {
+                radius = std::max(radius, glm::distance(center, positions[indices[i]]));
+            }
+
+            glm::vec3 axis(0.f);
+            auto cutoff = 2.f;
+            if (glm::length(normalSum) > 0.f) {
+                axis = glm::normalize(normalSum);
+                auto minDot = 1.f;
+                for (auto const &normal : normals) {
+                    minDot = std::min(minDot, glm::dot(axis, normal));
+                }
+                // sine of the cone half angle, the culling test adds the radius as it has no apex.
+                // Cone spread over 90 degrees can always be seen from some side.
+                if (minDot > 0.f) {
+                    cutoff = std::sqrt(1.f - minDot * minDot);
+                }
+            }
+
+            meshlet.center = {center.x, center.y, center.z};
+            meshlet.radius = radius;
+            meshlet.coneAxis = {axis.x, axis.y, axis.z};
+            meshlet.coneCutoff = cutoff;
+            meshlet.boundsMin = {low.x, low.y, low.z};
+            meshlet.boundsMax = {high.x, high.y, high.z};
+            result.push_back(meshlet);
+        };
+
+        Size first = 0, vertices = 0;
+        auto triangleCount = indices.size() / 3;
+
+        for (Size t = 0; t != triangleCount; ++t) {
+            Size newVertices = 0;
+            for (Size k = 0; k != 3; ++k) {
+                auto index = indices[t * 3 + k];
+                bool repeated = (k > 0 && indices[t * 3] == index) || (k > 1 && indices[t * 3 + 1] == index);
+                newVertices += stamp[index] != result.size() && !repeated;
+            }
+
+            if (t != first && (vertices + newVertices > options.maxVertices || t - first == options.maxTriangles)) {
+                finish(first, t);
+                first = t;
+                vertices = 0;
+            }
+
+            for (Size k = 0; k != 3; ++k) {
+                auto index = indices[t * 3 + k];
+                if (stamp[index] != result.size()) {
+                    stamp[index] = result.size();
+                    ++vertices;
+                }
+            }
+        }
+
+        if (first != triangleCount) {
+            finish(first, triangleCount);
+        }
+
+        return result;
+    }
+
+    vector<uint32_t> simplifyMesh(span<uint32_t const> indices, span<glm::vec3 const> positions,
+            Size targetIndexCount, float targetError, float &resultError) {
+        auto vertexCount = positions.size();
+        vector<uint32_t> result(indices.begin(), indices.end());
+        resultError = 0.f;
+
+        if (vertexCount == 0 || result.size() <= targetIndexCount) {
+            return result;
+        }
+
+        // errors are measured in units of the mesh extent
+        glm::vec3 low(std::numeric_limits<float>::max()), high(std::numeric_limits<float>::lowest());
+        for (auto const &p : positions) {
+            low = glm::min(low, p);
+            high = glm::max(high, p);
+        }
+        auto extent = std::max({high.x - low.x, high.y - low.y, high.z - low.z});
+        auto scale = extent > 0.f ? 1.f / extent : 1.f;
+
+        vector<glm::vec3> points(vertexCount);
+        for (Size v = 0; v != vertexCount; ++v) {
+            points[v] = (positions[v] - low) * scale;
+        }
+
+        auto locked = lockedVertices(indices, positions);
+
+        vector<Quadric> quadrics(vertexCount);
+        for (Size i = 0; i < result.size(); i += 3) {
+            auto const &a = points[result[i]], &b = points[result[i + 1]], &c = points[result[i + 2]];
+            auto normal = glm::cross(b - a, c - a);
+            auto length = glm::length(normal);
+            if (length == 0.f) {
+                continue;
+            }
+            normal /= length;
+
+            auto plane = Quadric::plane(normal.x, normal.y, normal.z, -glm::dot(normal, a));
+            for (Size k = 0; k != 3; ++k) {
+                quadrics[result[i + k]] += plane;
+            }
+        }
+
+        auto maxCost = double(targetError) * double(targetError);
+        double worstCost = 0;
+
+        vector<uint32_t> target(vertexCount);
+        vector<bool> touched(vertexCount);
+        vector<Collapse> collapses;
+        vector<Size> adjacencyOffset(vertexCount + 1), adjacency;
+
+        while (result.size() > targetIndexCount) {
+            collapses.clear();
+            for (Size i = 0; i < result.size(); i += 3) {
+                for (Size k = 0; k != 3; ++k) {
+                    auto a = result[i + k], b = result[i + (k + 1) % 3];
+                    for (auto [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+                        if (!locked[from]) {
+                            auto combined = quadrics[from];
+                            combined += quadrics[to];
+                            collapses.push_back({from, to, std::max(combined.error(points[to]), 0.0)});
+                        }
+                    }
+                }
+            }
+            ranges::sort(collapses, {}, &Collapse::cost);
+
+            ranges::fill(adjacencyOffset, 0);
+            for (auto index : result) {
+                ++adjacencyOffset[index + 1];
+            }
+            std::partial_sum(adjacencyOffset.begin(), adjacencyOffset.end(), adjacencyOffset.begin());
+            adjacency.resize(result.size());
+            vector<Size> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (Size i = 0; i != result.size(); ++i) {
+                adjacency[fill[result[i]]++] = i / 3;
+            }
+
+            std::iota(target.begin(), target.end(), 0);
+            std::fill(touched.begin(), touched.end(), false);
+
+            auto trianglesToRemove = (result.size() - targetIndexCount) / 3;
+            Size removed = 0;
+
+            for (auto const &collapse : collapses) {
+                if (collapse.cost > maxCost || removed >= trianglesToRemove) {
+                    break;
+                }
+                if (touched[collapse.from] || touched[collapse.to]) {
+                    continue;
+                }
+
+                // triangles around the moved vertex must not flip
+                bool flips = false;
+                Size collapsed = 0;
+                for (auto a = adjacencyOffset[collapse.from]; a != adjacencyOffset[collapse.from + 1]; ++a) {
+                    auto triangle = &result[adjacency[a] * 3];
+                    if (ranges::find(triangle, triangle + 3, collapse.to) != triangle + 3) {
+                        ++collapsed;
+                        continue;
+                    }
+
+                    glm::vec3 corners[3], moved[3];
+                    for (Size k = 0; k != 3; ++k) {
+                        corners[k] = points[triangle[k]];
+                        moved[k] = triangle[k] == collapse.from ? points[collapse.to] : corners[k];
+                    }
+                    auto before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                    auto after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    if (glm::dot(before, after) <= 0.f) {
+                        flips = true;
+                        break;
+                    }
+                }
+                if (flips) {
+                    continue;
+                }
+
+                target[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                worstCost = std::max(worstCost, collapse.cost);
+                removed += collapsed;
+
+                // the one ring is frozen until the next pass so collapses never overlap
+                for (auto a = adjacencyOffset[collapse.from]; a != adjacencyOffset[collapse.from + 1]; ++a) {
+                    for (Size k = 0; k != 3; ++k) {
+                        touched[result[adjacency[a] * 3 + k]] = true;
+                    }
+                }
+            }
+
+            if (removed == 0) {
+                break;
+            }
+
+            Size write = 0;
+            for (Size i = 0; i < result.size(); i += 3) {
+                auto a = target[result[i]], b = target[result[i + 1]], c = target[result[i + 2]];
+                if (a != b && b != c && a != c) {
+                    result[write++] = a;
+                    result[write++] = b;
+                    result[write++] = c;
+                }
+            }
+            result.resize(write);
+        }
+
+        resultError = float(std::sqrt(worstCost));
+        return result;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "MeshLoader.hpp"
+
+namespace rise::util {
+    struct VertexCacheStats {
+        // cache misses per triangle and per referenced vertex
+        float acmr = 0.f;
+        float atvr = 0.f;
+    };
+
+    // Merges vertices with identical packed bytes and remaps indices, returns the new vertex count.
+    // Big meshes are hashed and deduplicated in parallel when a pool is given.
+    Size weldVertices(span<uint32_t> indices, span<uint8_t> vertices, Size vertexSize, ThreadPool *pool);
+
+    VertexCacheStats analyzeVertexCache(span<uint32_t const> indices, Size vertexCount, Size cacheSize);
+
+    // Forsyth's linear-speed vertex cache optimization, reorders triangles in place
+    void optimizeVertexCache(span<uint32_t> indices, Size vertexCount);
+
+    // Splits the cache optimized order into clusters and sorts them front to back from the outside
+    // of the mesh in. Clusters may lose up to threshold times of their vertex cache efficiency.
+    void optimizeOverdraw(span<uint32_t> indices, span<glm::vec3 const> positions, Size cacheSize,
+            float threshold);
+
+    // Reorders vertices by first use and drops unreferenced ones, returns the new vertex count
+    Size optimizeVertexFetch(span<uint32_t> indices, span<uint8_t> vertices, Size vertexSize);
+
+    // Cuts the index buffer into consecutive meshlets in its current triangle order
+    vector<MeshletData> buildMeshlets(span<uint32_t const> indices, span<glm::vec3 const> positions,
+            MeshletOptions const &options);
+
+    // Quadric error edge collapse down to targetIndexCount indices or until the error, relative to
+    // the mesh extent, would pass targetError. Border and attribute seam vertices never move.
+    vector<uint32_t> simplifyMesh(span<uint32_t const> indices, span<glm::vec3 const> positions,
+            Size targetIndexCount, float targetError, float &resultError);
+}
@@ -1,7 +1,13 @@
 #include "PipelineLoader.hpp"
 #include "../Exception.hpp"
-#include <cista/mmap.h>
-#include <cista/serialization.h>
+#include <cista/hash.h>
+#include <spirv_cross.hpp>
+#include <random>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 namespace rise {
     using namespace util;
@@ -9,58 +15,681 @@ namespace rise {
     namespace {
         constexpr auto serializeMode = cista::mode::WITH_INTEGRITY | cista::mode::UNCHECKED;
 
+        // part of every reflection key, bump when reflection output changes
+        constexpr uint64_t reflectionVersion = 1;
+
+        constexpr uint32_t spirvMagic = 0x07230203;
+
+        uint64_t resourceKey(PipelineHandle pipeline, ResourceKind kind, uint32_t name) {
+            return uint64_t(pipeline.index) << 34 | uint64_t(kind) << 32 | name;
+        }
+
+        // stage inputs of a pipeline are vertex shader inputs, stage outputs fragment shader outputs
+        bool inStage(ResourceKind kind, ShaderType stage) {
+            switch (kind) {
+                case ResourceKind::StageInput:
+                    return stage == ShaderType::Vertex;
+                case ResourceKind::StageOutput:
+                    return stage == ShaderType::Fragment;
+                default:
+                    return true;
+            }
+        }
+
         SPIRVBinary readSPIRV(fs::path const &path) {
             std::ifstream file(path, std::ios::ate | std::ios::binary);
-            if (!file) throw FileError("Fail open file", path);
+            if (!file) {
+                throw FileError("Fail open file", path);
+            }
+
+            auto size = Size(file.tellg());
+            if (size % sizeof(uint32_t) != 0 || size < sizeof(uint32_t)) {
+                throw FileError("Shader is not SPIR-V", path);
+            }
+
+            SPIRVBinary binary(size / sizeof(uint32_t));
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(binary.data()), std::streamsize(size));
+            if (!file || binary[0] != spirvMagic) {
+                throw FileError("Shader is not SPIR-V", path);
+            }
+            return binary;
+        }
+
+        vector<uint8_t> readFile(fs::path const &path) {
+            std::ifstream file(path, std::ios::ate | std::ios::binary);
+            if (!file) {
+                throw FileError("Fail open file", path);
+            }
+
+            vector<uint8_t> bytes(Size(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(bytes.data()), std::streamsize(bytes.size()));
+            if (!file) {
+                throw FileError("Fail to read file", path);
+            }
+            return bytes;
+        }
+
+        // written aside and renamed over path, readers and watchers never see a half written file
+        void writeFile(fs::path const &path, span<uint8_t const> bytes) {
+            thread_local std::mt19937_64 random(std::random_device{}());
+            auto tempPath = fs::path(path).concat(fmt::format(".{:016x}.tmp", random()));
+            {
+                ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<char const *>(bytes.data()), std::streamsize(bytes.size()));
+                if (!file) {
+                    throw FileError("Fail to write converted pipeline", tempPath);
+                }
+            }
+            fs::rename(tempPath, path);
+        }
+
+        uint64_t reflectionKey(span<uint32_t const> binary) {
+            auto key = cista::hash(string_view(reinterpret_cast<char const *>(&reflectionVersion),
+                    sizeof(reflectionVersion)));
+            return cista::hash(string_view(reinterpret_cast<char const *>(binary.data()), binary.size_bytes()), key);
+        }
+
+        BaseType toBaseType(spirv_cross::SPIRType::BaseType type) {
+            using Type = spirv_cross::SPIRType;
+            switch (type) {
+                case Type::Boolean:
+                    return BaseType::Boolean;
+                case Type::SByte:
+                case Type::Short:
+                case Type::Int:
+                case Type::Int64:
+                    return BaseType::Int;
+                case Type::UByte:
+                case Type::UShort:
+                case Type::UInt:
+                case Type::UInt64:
+                    return BaseType::UInt;
+                case Type::Half:
+                case Type::Float:
+                case Type::Double:
+                    return BaseType::Float;
+                case Type::Struct:
+                    return BaseType::Struct;
+                case Type::Image:
+                    return BaseType::Image;
+                case Type::SampledImage:
+                    return BaseType::SampledImage;
+                case Type::Sampler:
+                    return BaseType::Sampler;
+                default:
+                    return BaseType::Unknown;
+            }
+        }
+
+        void addResources(spirv_cross::Compiler const &compiler,
+                spirv_cross::SmallVector<spirv_cross::Resource> const &resources, ResourceKind kind,
+                ShaderReflectionData &data) {
+            for (auto const &resource : resources) {
+                auto const &type = compiler.get_type(resource.type_id);
+
+                ReflectedResourceData reflected = {};
+                reflected.name = resource.name;
+                reflected.kind = kind;
+                reflected.set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+                reflected.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+                reflected.location = compiler.get_decoration(resource.id, spv::DecorationLocation);
+                reflected.baseType = toBaseType(type.basetype);
+                reflected.width = type.width;
+                reflected.vecSize = type.vecsize;
+                reflected.columns = type.columns;
+                if (type.basetype == spirv_cross::SPIRType::Struct) {
+                    reflected.size = uint32_t(compiler.get_declared_struct_size(compiler.get_type(resource.base_type_id)));
+                }
+                for (auto dimension : type.array) {
+                    reflected.array.push_back(dimension);
+                }
+                data.resources.push_back(std::move(reflected));
+            }
+        }
+
+        std::unique_ptr<ShaderReflectionData> reflect(span<uint32_t const> binary) {
+            spirv_cross::Compiler compiler(binary.data(), binary.size());
+            auto resources = compiler.get_shader_resources();
+
+            auto data = std::make_unique<ShaderReflectionData>();
+            data->key = reflectionKey(binary);
+            addResources(compiler, resources.uniform_buffers, ResourceKind::UniformBuffer, *data);
+            addResources(compiler, resources.sampled_images, ResourceKind::SampledImage, *data);
+            addResources(compiler, resources.stage_inputs, ResourceKind::StageInput, *data);
+            addResources(compiler, resources.stage_outputs, ResourceKind::StageOutput, *data);
+            return data;
+        }
+
+        // reads the SPIR-V and takes the baked reflection when its key matches
+        void readShader(fs::path const &folder, string const &name, ShaderInfo &shader) {
+            shader.binary = readSPIRV(folder / (name + ".spv"));
+            auto key = reflectionKey(shader.binary);
+
+            auto reflectPath = folder / (name + ".reflect");
+            if (!fs::exists(reflectPath)) {
+                spdlog::warn("Shader {}: no baked reflection", name);
+                return;
+            }
+
+            shader.reflectionFile = readFile(reflectPath);
+            ShaderReflectionData const *baked = nullptr;
+            try {
+                baked = cista::deserialize<ShaderReflectionData, serializeMode>(shader.reflectionFile);
+            } catch (std::exception const &) {
+                // a damaged table is treated like an out of date one
+            }
+            if (!baked || baked->key != key) {
+                spdlog::warn("Shader {}: reflection is out of date", name);
+                shader.reflectionFile = {};
+                return;
+            }
+            shader.reflection = baked;
+        }
+
+        uint64_t layoutHash(DescriptorSetLayout const &layout) {
+            return cista::hash(string_view(reinterpret_cast<char const *>(layout.bindings.data()),
+                    layout.bindings.size() * sizeof(DescriptorBinding)));
+        }
 
-            return {std::istream_iterator<uint32_t>(file), std::istream_iterator<uint32_t>()};
+        uint64_t layoutHash(VertexInputLayout const &layout) {
+            auto seed = cista::hash(string_view(reinterpret_cast<char const *>(&layout.stride), sizeof(layout.stride)));
+            return cista::hash(string_view(reinterpret_cast<char const *>(layout.attributes.data()),
+                    layout.attributes.size() * sizeof(VertexInputAttribute)), seed);
+        }
+
+        // index of an equal layout, the layout is added when there is none
+        template<typename Layout>
+        Index addUnique(vector<Layout> &layouts, std::unordered_multimap<uint64_t, Index> &ids, Layout layout) {
+            auto hash = layoutHash(layout);
+            for (auto [it, end] = ids.equal_range(hash); it != end; ++it) {
+                if (layouts[it->second] == layout) {
+                    return it->second;
+                }
+            }
+            ids.emplace(hash, layouts.size());
+            layouts.push_back(std::move(layout));
+            return layouts.size() - 1;
+        }
+
+        DescriptorBinding toDescriptor(ReflectedResourceData const &resource, ShaderType stage) {
+            DescriptorBinding binding;
+            binding.binding = resource.binding;
+            binding.type = resource.kind == ResourceKind::UniformBuffer
+                    ? DescriptorType::UniformBuffer : DescriptorType::CombinedImageSampler;
+            binding.count = std::accumulate(resource.array.begin(), resource.array.end(), uint32_t(1),
+                    std::multiplies<>());
+            binding.stages = stageBit(stage);
+            return binding;
+        }
+
+        template<typename ShaderIndex>
+        Pipeline readPipeline(fs::path const &folder, string const &name, ShaderIndex &&shaderIndex) {
+            fs::path path = folder / (name + ".rise");
+            if (!fs::exists(path)) {
+                throw FileError("Pipeline not found: " + name, path);
+            }
+
+            cista::mmap formatFile(path.c_str(), cista::mmap::protection::READ);
+            auto pipelineData = cista::deserialize<util::PipelineData, serializeMode>(formatFile);
+            if (!pipelineData) {
+                throw FileError("Fail to load pipeline", path);
+            }
+
+            Pipeline pipeline;
+            pipeline.name = name;
+            pipeline.vertexShader = shaderIndex(pipelineData->vertexShader.str());
+            pipeline.fragmentShader = shaderIndex(pipelineData->fragmentShader.str());
+            pipeline.depthStencil = pipelineData->depthStencil;
+            return pipeline;
+        }
+
+        template<typename F>
+        void forEach(ThreadPool *pool, Size count, F &&body) {
+            if (pool) {
+                pool->parallelFor(count, body);
+            } else {
+                for (Size i = 0; i != count; ++i) {
+                    body(i);
+                }
+            }
         }
     }
 
-    SPIRVBinary const &ImportedPipelines::spirvBinary(
-            string_view pipe, ShaderType type, string_view shader) const {
-        auto const& pipeline = mPipelines.at(pipe.data());
+    PipelineHandle ImportedPipelines::pipeline(string_view name) const {
+        auto pipeline = mPipelineIds.find(name);
+        if (pipeline == mPipelineIds.end()) {
+            throw std::runtime_error("pipeline not found: " + string(name));
+        }
+        return {pipeline->second};
+    }
+
+    span<uint32_t const> ImportedPipelines::spirvBinary(PipelineHandle handle, ShaderType type) const {
+        auto const &pipeline = mPipelines[handle.index];
 
         switch (type) {
             case ShaderType::Vertex:
-                return mVertexShaders.at(pipeline.vertexShader.data()).binary;
+                return mShaders[pipeline.vertexShader].binary;
             case ShaderType::Fragment:
-                return mVertexShaders.at(pipeline.fragmentShader.data()).binary;
+                return mShaders[pipeline.fragmentShader].binary;
+        }
+        throw std::runtime_error("not implemented shader type!");
+    }
+
+    ResourceId ImportedPipelines::find(PipelineHandle pipeline, ResourceKind kind, string_view name) const {
+        auto interned = mNames.find(name);
+        if (interned != mNames.end()) {
+            auto resource = mResources.find(resourceKey(pipeline, kind, interned->second));
+            if (resource != mResources.end()) {
+                return resource->second;
+            }
         }
+        throw std::runtime_error(fmt::format("Pipeline {} has no resource {}", mPipelines[pipeline.index].name, name));
     }
 
-    ResourceId ImportedPipelines::uniform(string_view pipelineName, string_view name) const {
-        auto const& pipeline = mPipelines.at(pipelineName.data());
-        if(mVertexShaders.at(pipeline.vertexShader.data()).resources.uniform_buffers.)
+    void ImportedPipelines::indexResources(uint32_t pipelineIndex) {
+        auto const &pipeline = mPipelines[pipelineIndex];
+        for (auto stage : {ShaderType::Vertex, ShaderType::Fragment}) {
+            auto shaderIndex = stage == ShaderType::Vertex ? pipeline.vertexShader : pipeline.fragmentShader;
+            auto const &resources = mShaders[shaderIndex].reflection->resources;
+            for (Index r = 0; r != resources.size(); ++r) {
+                if (!inStage(resources[r].kind, stage)) {
+                    continue;
+                }
+                auto name = mNames.try_emplace(resources[r].name.str(), uint32_t(mNames.size())).first->second;
+                // vertex resources are added first and are kept when the fragment shader repeats a name
+                mResources.try_emplace(resourceKey({pipelineIndex}, resources[r].kind, name),
+                        ResourceId{shaderIndex, r});
+            }
+        }
     }
 
-    ImportedPipelines PipelineImporter::load() {
-        ImportedPipelines result;
+    void ImportedPipelines::forgetResources(uint32_t pipelineIndex) {
+        std::erase_if(mResources, [&](auto const &entry) {
+            return entry.first >> 34 == pipelineIndex;
+        });
+    }
 
-        for (auto const &loaded: mPipelinesToLoad) {
-            fs::path path = mFolder / (loaded + ".rise");
+    ReflectedResourceData const &ImportedPipelines::resource(ResourceId id) const {
+        return mShaders.at(id.shaderIndex).reflection->resources.at(id.resource);
+    }
 
-            cista::mmap formatFile(path.c_str(), cista::mmap::protection::READ);
-            auto pipelineData = cista::deserialize<util::PipelineData, serializeMode>(formatFile);
+    ResourceType ImportedPipelines::type(ResourceId id) const {
+        auto const &reflected = resource(id);
+        return {reflected.baseType, reflected.width, reflected.vecSize, reflected.columns, reflected.size,
+                {reflected.array.data(), reflected.array.size()}};
+    }
 
-            Pipeline pipeline;
-            pipeline.vertexShader = pipelineData->vertexShader.str();
-            pipeline.fragmentShader = pipelineData->fragmentShader.str();
-            pipeline.depthStencil = pipelineData->depthStencil;
+    void ImportedPipelines::buildLayouts(Pipeline &pipeline) {
+        vector<DescriptorSetLayout> sets;
+        for (auto stage : {ShaderType::Vertex, ShaderType::Fragment}) {
+            auto shaderIndex = stage == ShaderType::Vertex ? pipeline.vertexShader : pipeline.fragmentShader;
+            for (auto const &resource : mShaders[shaderIndex].reflection->resources) {
+                if (resource.kind != ResourceKind::UniformBuffer && resource.kind != ResourceKind::SampledImage) {
+                    continue;
+                }
+                if (resource.set >= sets.size()) {
+                    sets.resize(resource.set + 1);
+                }
 
+                auto descriptor = toDescriptor(resource, stage);
+                auto &bindings = sets[resource.set].bindings;
+                auto it = ranges::lower_bound(bindings, descriptor.binding, {}, &DescriptorBinding::binding);
+                if (it == bindings.end() || it->binding != descriptor.binding) {
+                    bindings.insert(it, descriptor);
+                } else if (it->type == descriptor.type && it->count == descriptor.count) {
+                    it->stages |= descriptor.stages;
+                } else {
+                    throw std::runtime_error(fmt::format("Pipeline {}: shaders declare set {} binding {} differently",
+                            pipeline.name, resource.set, resource.binding));
+                }
+            }
+        }
 
-            ShaderInfo shader(readSPIRV(path));
+        pipeline.setLayouts.clear();
+        for (auto &set : sets) {
+            pipeline.setLayouts.push_back(addUnique(mSetLayouts, mSetLayoutIds, std::move(set)));
+        }
 
-            if (!result.mVertexShaders.contains(pipeline.vertexShader.data())) {
-                result.mVertexShaders.emplace(pipeline.vertexShader, shader);
+        // stage inputs are matched to attributes by name, the names given to MeshConvertOp
+        auto const &inputs = mShaders[pipeline.vertexShader].reflection->resources;
+        pipeline.vertexLayouts.clear();
+        for (auto const &format : mVertexFormats) {
+            VertexInputLayout layout;
+            layout.stride = uint32_t(format.vertexSize);
+
+            bool complete = true;
+            for (auto const &input : inputs) {
+                if (input.kind != ResourceKind::StageInput) {
+                    continue;
+                }
+                auto attribute = format.attributes.find(input.name.view());
+                if (attribute == format.attributes.end()) {
+                    complete = false;
+                    break;
+                }
+                layout.attributes.push_back({input.location, attribute->second.format,
+                        uint32_t(attribute->second.offset)});
             }
-            if (!result.mVertexShaders.contains(pipeline.fragmentShader.data())) {
-                result.mVertexShaders.emplace(pipeline.fragmentShader, shader);
+
+            if (!complete) {
+                pipeline.vertexLayouts.push_back(noLayout);
+                continue;
             }
+            ranges::sort(layout.attributes, {}, &VertexInputAttribute::location);
+            pipeline.vertexLayouts.push_back(addUnique(mVertexLayouts, mVertexLayoutIds, std::move(layout)));
+        }
+    }
+
+    Index ImportedPipelines::vertexInputLayout(PipelineHandle handle, Index formatGroup) const {
+        auto const &pipeline = mPipelines[handle.index];
+        if (formatGroup >= pipeline.vertexLayouts.size()) {
+            throw std::runtime_error(fmt::format("Pipeline {}: format group {} was not matched on load",
+                    pipeline.name, formatGroup));
+        }
+        if (pipeline.vertexLayouts[formatGroup] == noLayout) {
+            throw std::runtime_error(fmt::format("Pipeline {}: format group {} lacks attributes of its vertex inputs",
+                    pipeline.name, formatGroup));
+        }
+        return pipeline.vertexLayouts[formatGroup];
+    }
+
+    ResourceBinding ImportedPipelines::binding(ResourceId id) const {
+        auto const &reflected = resource(id);
+        return {reflected.set, reflected.binding, reflected.location};
+    }
+
+    unsigned ImportedPipelines::decoration(ResourceId id, spv::Decoration decoration) const {
+        auto const &reflected = resource(id);
+        switch (decoration) {
+            case spv::DecorationDescriptorSet:
+                return reflected.set;
+            case spv::DecorationBinding:
+                return reflected.binding;
+            case spv::DecorationLocation:
+                return reflected.location;
+            default:
+                throw std::runtime_error("decoration is not reflected!");
         }
+    }
+
+    Size ImportedPipelines::reload(span<fs::path const> files, ThreadPool *pool) {
+        set<Index> changedShaders;
+        set<uint32_t> changedPipelines;
+        for (auto const &file : files) {
+            auto name = file.stem().string();
+            auto extension = file.extension();
+            if (extension == ".rise") {
+                if (auto pipeline = mPipelineIds.find(name); pipeline != mPipelineIds.end()) {
+                    changedPipelines.insert(pipeline->second);
+                }
+            } else if (extension == ".spv" || extension == ".reflect") {
+                if (auto shader = mShaderIds.find(name); shader != mShaderIds.end()) {
+                    changedShaders.insert(shader->second);
+                }
+            }
+        }
+        if (changedShaders.empty() && changedPipelines.empty()) {
+            return 0;
+        }
+
+        auto start = time::steady_clock::now();
+
+        // changed shaders then shaders named by changed descriptions that were not loaded yet
+        vector<Index> shaderIndices(changedShaders.begin(), changedShaders.end());
+        vector<string> shaderNames(shaderIndices.size());
+        for (auto const &[name, index] : mShaderIds) {
+            if (auto it = ranges::find(shaderIndices, index); it != shaderIndices.end()) {
+                shaderNames[it - shaderIndices.begin()] = name;
+            }
+        }
+        auto firstNewShader = shaderIndices.size();
+        auto shaderIndex = [&](string name) {
+            if (auto shader = mShaderIds.find(name); shader != mShaderIds.end()) {
+                return shader->second;
+            }
+            auto known = ranges::find(shaderNames.begin() + Offset(firstNewShader), shaderNames.end(), name);
+            if (known == shaderNames.end()) {
+                shaderIndices.push_back(mShaders.size() + shaderIndices.size() - firstNewShader);
+                shaderNames.push_back(std::move(name));
+                return shaderIndices.back();
+            }
+            return shaderIndices[known - shaderNames.begin()];
+        };
+
+        vector<uint32_t> describedPipelines(changedPipelines.begin(), changedPipelines.end());
+        vector<Pipeline> pipelines;
+        vector<ShaderInfo> shaders;
+        try {
+            for (auto index : describedPipelines) {
+                pipelines.push_back(readPipeline(mFolder, mPipelines[index].name, shaderIndex));
+            }
+
+            shaders.resize(shaderNames.size());
+            forEach(pool, shaders.size(), [&](Size i) {
+                readShader(mFolder, shaderNames[i], shaders[i]);
+                if (!shaders[i].reflection) {
+                    shaders[i].reflected = reflect(shaders[i].binary);
+                    shaders[i].reflection = shaders[i].reflected.get();
+                }
+            });
+        } catch (std::exception const &error) {
+            // files may be caught half written, the next write brings another reload
+            spdlog::error("Reloading pipelines failed, keeping the previous ones: {}", error.what());
+            return 0;
+        }
+
+        // pipelines using a changed shader change too
+        for (uint32_t i = 0; i != mPipelines.size(); ++i) {
+            if (changedShaders.contains(mPipelines[i].vertexShader)
+                    || changedShaders.contains(mPipelines[i].fragmentShader)) {
+                changedPipelines.insert(i);
+            }
+        }
+
+        auto swapShaders = [&] {
+            for (Index i = 0; i != firstNewShader; ++i) {
+                std::swap(mShaders[shaderIndices[i]], shaders[i]);
+            }
+        };
+        auto swapPipelines = [&] {
+            for (Index i = 0; i != describedPipelines.size(); ++i) {
+                std::swap(mPipelines[describedPipelines[i]], pipelines[i]);
+            }
+        };
+        auto rebuild = [&] {
+            for (auto index : changedPipelines) {
+                forgetResources(index);
+                indexResources(index);
+                buildLayouts(mPipelines[index]);
+            }
+        };
+
+        swapShaders();
+        for (auto i = firstNewShader; i != shaders.size(); ++i) {
+            mShaderIds.emplace(shaderNames[i], mShaders.size());
+            mShaders.push_back(std::move(shaders[i]));
+        }
+        swapPipelines();
+        try {
+            rebuild();
+        } catch (std::exception const &error) {
+            spdlog::error("Reloading pipelines failed, keeping the previous ones: {}", error.what());
+            swapPipelines();
+            swapShaders();
+            for (auto i = firstNewShader; i != shaders.size(); ++i) {
+                mShaderIds.erase(shaderNames[i]);
+                mShaders.pop_back();
+            }
+            rebuild();
+            return 0;
+        }
+
+        ++mGeneration;
+        for (auto index : changedPipelines) {
+            mPipelines[index].generation = mGeneration;
+        }
+
+        time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+        spdlog::info("Reloaded {} shaders and {} pipelines in {:.2f} ms, generation {}", shaders.size(),
+                changedPipelines.size(), elapsed.count(), mGeneration);
+        return changedPipelines.size();
+    }
+
+    void PipelineConverter::addPipeline(string const &name, string const &vertexShader,
+            string const &fragmentShader, bool depthStencil) {
+        mPipelines[name] = {vertexShader, fragmentShader, depthStencil};
+    }
+
+    void PipelineConverter::convert(fs::path const &dst) const {
+        spdlog::info("Converting {} pipelines to folder {}", mPipelines.size(), dst.string());
+        fs::create_directories(dst);
+
+        set<string> shaders;
+        for (auto const &[name, desc] : mPipelines) {
+            PipelineData data = {};
+            data.vertexShader = desc.vertexShader;
+            data.fragmentShader = desc.fragmentShader;
+            data.depthStencil = desc.depthStencil;
+            writeFile(dst / (name + ".rise"), cista::serialize<serializeMode>(data));
+
+            shaders.insert(desc.vertexShader);
+            shaders.insert(desc.fragmentShader);
+        }
+
+        for (auto const &shader : shaders) {
+            auto source = mShaderFolder / (shader + ".spv");
+            auto binary = readSPIRV(source);
+
+            auto target = dst / (shader + ".spv");
+            if (!fs::exists(target) || !fs::equivalent(source, target)) {
+                writeFile(target, {reinterpret_cast<uint8_t const *>(binary.data()), binary.size() * sizeof(uint32_t)});
+            }
+
+            auto reflection = reflect(binary);
+            writeFile(dst / (shader + ".reflect"), cista::serialize<serializeMode>(*reflection));
+            spdlog::info("Shader {}: baked {} resources", shader, reflection->resources.size());
+        }
+    }
+
+    ImportedPipelines PipelineImporter::load(ThreadPool *pool, MeshDrawPlanner const *meshes) {
+        ImportedPipelines result;
+        auto start = time::steady_clock::now();
+
+        // pipelines are read first to find the unique shaders, shared ones are loaded once
+        vector<string const *> shaderNames;
+        auto shaderIndex = [&](string name) {
+            auto [it, inserted] = result.mShaderIds.emplace(std::move(name), Index(shaderNames.size()));
+            if (inserted) {
+                shaderNames.push_back(&it->first);
+            }
+            return it->second;
+        };
+
+        result.mFolder = mFolder;
+        for (auto const &loaded : mPipelinesToLoad) {
+            if (result.mPipelineIds.contains(loaded)) {
+                continue;
+            }
+            result.mPipelineIds.emplace(loaded, uint32_t(result.mPipelines.size()));
+            result.mPipelines.push_back(readPipeline(mFolder, loaded, shaderIndex));
+        }
+        auto described = time::steady_clock::now();
+
+        result.mShaders.resize(shaderNames.size());
+        forEach(pool, shaderNames.size(), [&](Size i) {
+            readShader(mFolder, *shaderNames[i], result.mShaders[i]);
+        });
+        auto read = time::steady_clock::now();
+
+        std::atomic<Size> reflectedCount = 0;
+        forEach(pool, shaderNames.size(), [&](Size i) {
+            auto &shader = result.mShaders[i];
+            if (!shader.reflection) {
+                shader.reflected = reflect(shader.binary);
+                shader.reflection = shader.reflected.get();
+                ++reflectedCount;
+            }
+        });
+        for (uint32_t i = 0; i != result.mPipelines.size(); ++i) {
+            result.indexResources(i);
+        }
+        auto reflected = time::steady_clock::now();
+
+        if (meshes) {
+            for (auto const &group : *meshes) {
+                result.mVertexFormats.push_back({group.vertexSize(), {group.attributes().begin(),
+                        group.attributes().end()}});
+            }
+        }
+        for (auto &pipeline : result.mPipelines) {
+            result.buildLayouts(pipeline);
+        }
+        auto laidOut = time::steady_clock::now();
+
+        using Ms = time::duration<double, std::milli>;
+        auto &times = result.mLoadTimes;
+        times.pipelines = Ms(described - start).count();
+        times.shaders = Ms(read - described).count();
+        times.reflection = Ms(reflected - read).count();
+        times.layouts = Ms(laidOut - reflected).count();
+        spdlog::info("Loaded {} pipelines with {} shaders ({} reflected at runtime): pipelines {:.2f} ms, "
+                     "shaders {:.2f} ms, reflection {:.2f} ms, layouts {:.2f} ms", result.mPipelines.size(),
+                shaderNames.size(), reflectedCount.load(), times.pipelines, times.shaders, times.reflection,
+                times.layouts);
+        spdlog::info("Pipelines share {} descriptor set layouts and {} vertex input layouts",
+                result.mSetLayouts.size(), result.mVertexLayouts.size());
 
         return result;
     }
 
+#ifdef __linux__
+    PipelineWatcher::PipelineWatcher(ImportedPipelines &pipelines) : mPipelines(pipelines) {
+        mNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mNotify < 0) {
+            throw std::runtime_error(fmt::format("Fail to start inotify: {}", std::strerror(errno)));
+        }
+
+        // PipelineConverter renames finished files over the old ones, compilers often write in place
+        if (inotify_add_watch(mNotify, mPipelines.mFolder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(mNotify);
+            throw FileError("Fail to watch pipeline folder", mPipelines.mFolder);
+        }
+        spdlog::info("Watching pipeline folder {}", mPipelines.mFolder.string());
+    }
+
+    PipelineWatcher::~PipelineWatcher() {
+        close(mNotify);
+    }
+
+    Size PipelineWatcher::poll(ThreadPool *pool) {
+        vector<fs::path> changed;
+        alignas(inotify_event) char buffer[4096];
 
+        ssize_t size;
+        while ((size = read(mNotify, buffer, sizeof(buffer))) > 0) {
+            for (char const *position = buffer; position < buffer + size;) {
+                auto event = reinterpret_cast<inotify_event const *>(position);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // events were dropped, every imported pipeline is read again
+                    for (auto const &pipeline : mPipelines.mPipelines) {
+                        changed.emplace_back(pipeline.name + ".rise");
+                    }
+                    for (auto const &shader : mPipelines.mShaderIds) {
+                        changed.emplace_back(shader.first + ".spv");
+                    }
+                } else if (event->len != 0) {
+                    changed.emplace_back(event->name);
+                }
+                position += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (size < 0 && errno != EAGAIN) {
+            spdlog::error("Fail to read pipeline folder changes: {}", std::strerror(errno));
+        }
+
+        return changed.empty() ? 0 : mPipelines.reload(changed, pool);
+    }
+#endif
 }
@@ -1,6 +1,6 @@
 #pragma once
 #include "MeshLoader.hpp"
-#include <spirv_cross.hpp>
+#include <spirv.hpp>
 
 namespace rise {
     enum class ShaderType {
@@ -8,9 +8,98 @@ namespace rise {
         Fragment,
     };
 
+    enum class ResourceKind : uint32_t {
+        UniformBuffer,
+        SampledImage,
+        StageInput,
+        StageOutput,
+    };
+
+    // Scalar type of a resource, integer and float widths are kept in ResourceType::width
+    enum class BaseType : uint32_t {
+        Unknown,
+        Boolean,
+        Int,
+        UInt,
+        Float,
+        Struct,
+        Image,
+        SampledImage,
+        Sampler,
+    };
+
+    // Resolved once from a name by ImportedPipelines, valid for the pipelines that returned it
+    struct PipelineHandle {
+        uint32_t index;
+    };
+
+    // Indices into the reflection tables of an ImportedPipelines
     struct ResourceId {
-        spirv_cross::ID id;
         Index shaderIndex = 0;
+        Index resource = 0;
+    };
+
+    struct ResourceType {
+        BaseType baseType = BaseType::Unknown;
+        uint32_t width = 0;
+        uint32_t vecSize = 1;
+        uint32_t columns = 1;
+        // declared size of uniform blocks, 0 for other resources
+        uint32_t size = 0;
+        // array dimensions, empty when the resource is not an array
+        span<uint32_t const> array;
+    };
+
+    // Decorations of a resource, set and binding for descriptors, location for stage inputs and outputs
+    struct ResourceBinding {
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        uint32_t location = 0;
+    };
+
+    enum class DescriptorType : uint32_t {
+        UniformBuffer,
+        CombinedImageSampler,
+    };
+
+    // Bit of a stage in DescriptorBinding::stages
+    constexpr uint32_t stageBit(ShaderType stage) {
+        return 1u << uint32_t(stage);
+    }
+
+    struct DescriptorBinding {
+        uint32_t binding = 0;
+        DescriptorType type = DescriptorType::UniformBuffer;
+        // array elements, 1 when not an array and 0 for runtime sized arrays
+        uint32_t count = 1;
+        // stageBit of every stage using the binding
+        uint32_t stages = 0;
+
+        bool operator==(DescriptorBinding const &) const = default;
+    };
+
+    // Bindings of one descriptor set sorted by binding number
+    struct DescriptorSetLayout {
+        vector<DescriptorBinding> bindings;
+
+        bool operator==(DescriptorSetLayout const &) const = default;
+    };
+
+    struct VertexInputAttribute {
+        uint32_t location = 0;
+        Format format = Format::Undefined;
+        uint32_t offset = 0;
+
+        bool operator==(VertexInputAttribute const &) const = default;
+    };
+
+    // Vertex shader inputs read from the single interleaved vertex binding of a mesh format group
+    struct VertexInputLayout {
+        uint32_t stride = 0;
+        // sorted by location
+        vector<VertexInputAttribute> attributes;
+
+        bool operator==(VertexInputLayout const &) const = default;
     };
 
     using SPIRVBinary = vector<uint32_t>;
@@ -24,57 +113,262 @@ namespace rise {
             bool depthStencil;
         };
 
-        struct ShaderInfo {
-            explicit ShaderInfo(SPIRVBinary const& binary) :
-                binary(binary), compiler(binary), resources(compiler.get_shader_resources()) {}
+        struct ReflectedResourceData {
+            binary::string name;
+            ResourceKind kind;
+            uint32_t set;
+            uint32_t binding;
+            uint32_t location;
+            BaseType baseType;
+            uint32_t width;
+            uint32_t vecSize;
+            uint32_t columns;
+            uint32_t size;
+            binary::vector<uint32_t> array;
+        };
 
+        // reflection of one shader as baked next to it in <shader>.reflect, key covers the SPIR-V it was made from
+        struct ShaderReflectionData {
+            uint64_t key;
+            binary::vector<ReflectedResourceData> resources;
+        };
+
+        // one per shader file, shared by every pipeline using the shader. Files are copied, not
+        // mapped, so rewriting them in place never changes a loaded shader.
+        struct ShaderInfo {
             SPIRVBinary binary;
-            spirv_cross::Compiler compiler;
-            spirv_cross::ShaderResources resources;
+            ShaderReflectionData const *reflection = nullptr;
+            // one of them owns the reflection, the baked table or the runtime fallback
+            vector<uint8_t> reflectionFile;
+            std::unique_ptr<ShaderReflectionData> reflected;
         };
 
         struct Pipeline {
-            string_view vertexShader;
-            string_view fragmentShader;
+            string name;
+            Index vertexShader = 0;
+            Index fragmentShader = 0;
             bool depthStencil = false;
+            // by set number, index into the descriptor set layouts
+            vector<Index> setLayouts;
+            // by format group of the planner matched on load, noLayout when an input has no attribute
+            vector<Index> vertexLayouts;
+            // ImportedPipelines::generation of the reload that last changed the pipeline
+            uint64_t generation = 0;
+        };
+
+        // copy of a mesh format group, kept to match vertex inputs again when shaders are reloaded
+        struct VertexFormat {
+            Size vertexSize;
+            map<string, VertexAttribute, std::less<>> attributes;
         };
     }
 
+    // Wall time of each load stage in milliseconds
+    struct PipelineLoadTimes {
+        // reading pipeline descriptions
+        double pipelines = 0;
+        // reading SPIR-V and baked reflection
+        double shaders = 0;
+        // runtime reflection of shaders without an up to date table and building the lookup tables
+        double reflection = 0;
+        // descriptor set and vertex input layouts
+        double layouts = 0;
+    };
+
     class ImportedPipelines : public NonCopyable {
         friend class PipelineImporter;
+        friend class PipelineWatcher;
     public:
-        SPIRVBinary const& spirvBinary(string_view pipe, ShaderType type, string_view shader) const;
+        // Throws when the pipeline was not imported
+        PipelineHandle pipeline(string_view name) const;
+
+        // Words of the .spv file, valid until the shader is reloaded
+        span<uint32_t const> spirvBinary(PipelineHandle pipeline, ShaderType type) const;
 
-        ResourceId uniform(string_view pipeline, string_view name) const;
+        span<uint32_t const> spirvBinary(string_view pipelineName, ShaderType type) const {
+            return spirvBinary(pipeline(pipelineName), type);
+        }
 
-        ResourceId sampledImage(string_view pipeline,string_view name) const;
+        PipelineLoadTimes const &loadTimes() const {
+            return mLoadTimes;
+        }
 
-        ResourceId stageInput(string_view pipeline, string_view name) const;
+        // Resources of the vertex shader take precedence over fragment shader ones with the same
+        // name, throws when not found. Lookups with a handle are hashed and allocation-free.
+        ResourceId uniform(PipelineHandle pipeline, string_view name) const {
+            return find(pipeline, ResourceKind::UniformBuffer, name);
+        }
 
-        ResourceId stageOutput(string_view pipeline, string_view name) const;
+        ResourceId sampledImage(PipelineHandle pipeline, string_view name) const {
+            return find(pipeline, ResourceKind::SampledImage, name);
+        }
 
-        spirv_cross::SPIRType type(ResourceId id) const;
+        // Inputs of the vertex shader
+        ResourceId stageInput(PipelineHandle pipeline, string_view name) const {
+            return find(pipeline, ResourceKind::StageInput, name);
+        }
+
+        // Outputs of the fragment shader
+        ResourceId stageOutput(PipelineHandle pipeline, string_view name) const {
+            return find(pipeline, ResourceKind::StageOutput, name);
+        }
+
+        ResourceId uniform(string_view pipelineName, string_view name) const {
+            return uniform(pipeline(pipelineName), name);
+        }
 
+        ResourceId sampledImage(string_view pipelineName, string_view name) const {
+            return sampledImage(pipeline(pipelineName), name);
+        }
+
+        ResourceId stageInput(string_view pipelineName, string_view name) const {
+            return stageInput(pipeline(pipelineName), name);
+        }
+
+        ResourceId stageOutput(string_view pipelineName, string_view name) const {
+            return stageOutput(pipeline(pipelineName), name);
+        }
+
+        ResourceType type(ResourceId id) const;
+
+        ResourceBinding binding(ResourceId id) const;
+
+        // DescriptorSet, Binding and Location are reflected, other decorations throw
         unsigned decoration(ResourceId id, spv::Decoration decoration) const;
 
+        static constexpr Index noLayout = std::numeric_limits<Index>::max();
+
+        // Unique layouts, pipelines with identical sets or vertex inputs share one entry so objects
+        // created from them can be reused across pipelines
+        span<DescriptorSetLayout const> descriptorSetLayouts() const {
+            return mSetLayouts;
+        }
+
+        span<VertexInputLayout const> vertexInputLayouts() const {
+            return mVertexLayouts;
+        }
+
+        // By set number an index into descriptorSetLayouts(), set numbers the pipeline skips get the empty layout
+        span<Index const> setLayouts(PipelineHandle pipeline) const {
+            return mPipelines[pipeline.index].setLayouts;
+        }
+
+        // Index into vertexInputLayouts() for drawing meshes of a format group of the planner given to load,
+        // throws when the format group lacks an attribute named like one of the vertex shader inputs
+        Index vertexInputLayout(PipelineHandle pipeline, Index formatGroup) const;
+
+        // Counts reloads that changed something, 0 after load
+        uint64_t generation() const {
+            return mGeneration;
+        }
+
+        // Generation of the last reload that changed the pipeline, objects built from it are out of
+        // date when it is newer than the generation they were built at
+        uint64_t generation(PipelineHandle pipeline) const {
+            return mPipelines[pipeline.index].generation;
+        }
+
+        // Reads changed .spv, .reflect and .rise files of the pipeline folder again, files of shaders
+        // and pipelines that were not imported are skipped. Shaders are read and reflected aside and
+        // swapped in only when every file loaded, otherwise the previous state is kept. Loaded files
+        // are copies, so files may be rewritten in place at any time. Handles stay valid, binaries
+        // and resource types of reloaded shaders do not.
+        // The swap is done in place and is not atomic for readers: call it from the thread that reads
+        // the pipelines while none of its spans, references or layouts are held, for example between
+        // frames once the frame in flight no longer reads them. The pool only reads files and reflects.
+        // Returns the number of changed pipelines.
+        Size reload(span<fs::path const> files, ThreadPool *pool = nullptr);
+
+    private:
+        util::ReflectedResourceData const &resource(ResourceId id) const;
+
+        ResourceId find(PipelineHandle pipeline, ResourceKind kind, string_view name) const;
+
+        // fills the interned names and the resource table once shaders are reflected
+        void indexResources(uint32_t pipeline);
+
+        void forgetResources(uint32_t pipeline);
+
+        void buildLayouts(util::Pipeline &pipeline);
+
+        fs::path mFolder;
+        vector<util::Pipeline> mPipelines;
+        StringMap<uint32_t> mPipelineIds;
+        vector<util::ShaderInfo> mShaders;
+        map<string, Index> mShaderIds;
+        // every resource name of every shader, interned so a lookup hashes the name once
+        StringMap<uint32_t> mNames;
+        // pipeline, resource kind and interned name packed by resourceKey
+        std::unordered_map<uint64_t, ResourceId> mResources;
+        // unique layouts and their indices by layout hash
+        vector<DescriptorSetLayout> mSetLayouts;
+        std::unordered_multimap<uint64_t, Index> mSetLayoutIds;
+        vector<VertexInputLayout> mVertexLayouts;
+        std::unordered_multimap<uint64_t, Index> mVertexLayoutIds;
+        vector<util::VertexFormat> mVertexFormats;
+        uint64_t mGeneration = 0;
+        PipelineLoadTimes mLoadTimes;
+    };
+
+    // Writes pipeline descriptions and bakes the reflection of their shaders offline, so the
+    // importer does not run SPIRV-Cross at startup
+    class PipelineConverter : public NonCopyable {
+    public:
+        // Shaders are read from <shaderFolder>/<shader>.spv
+        explicit PipelineConverter(fs::path shaderFolder) : mShaderFolder(std::move(shaderFolder)) {}
+
+        void addPipeline(string const &name, string const &vertexShader, string const &fragmentShader,
+                bool depthStencil);
+
+        // Writes <pipeline>.rise for every pipeline, and <shader>.spv with <shader>.reflect for every shader
+        void convert(fs::path const &dst) const;
+
     private:
-        map<string, util::Pipeline> mPipelines;
-        map<string, util::ShaderInfo> mVertexShaders;
-        map<string, util::ShaderInfo> mFragmentShaders;
+        struct PipelineDesc {
+            string vertexShader;
+            string fragmentShader;
+            bool depthStencil;
+        };
+
+        fs::path mShaderFolder;
+        map<string, PipelineDesc> mPipelines;
     };
 
-    class PipelineImporter : public NonCopyable  {
+    class PipelineImporter : public NonCopyable {
     public:
         explicit PipelineImporter(fs::path folder) : mFolder(std::move(folder)) {}
 
-        void import(string const& name) {
+        void import(string const &name) {
             mPipelinesToLoad.push_back(name);
         }
 
-        ImportedPipelines load();
+        // Every shader is loaded once however many pipelines use it. With a pool shaders are read
+        // and reflected in parallel, shaders without an up to date <shader>.reflect are
+        // reflected with SPIRV-Cross. Descriptor set layouts are built for every pipeline, and
+        // vertex input layouts for every format group of meshes when it is given.
+        ImportedPipelines load(ThreadPool *pool = nullptr, MeshDrawPlanner const *meshes = nullptr);
 
     private:
         fs::path mFolder;
         vector<string> mPipelinesToLoad;
     };
+
+#ifdef __linux__
+    // Watches the folder of imported pipelines with inotify for shaders and pipelines to reload. The
+    // pipelines must outlive the watcher and stay in place.
+    class PipelineWatcher : public NonCopyable {
+    public:
+        explicit PipelineWatcher(ImportedPipelines &pipelines);
+
+        ~PipelineWatcher();
+
+        // Never blocks, reloads the files written since the last call. Same threading rules as
+        // ImportedPipelines::reload. Returns the number of changed pipelines.
+        Size poll(ThreadPool *pool = nullptr);
+
+    private:
+        ImportedPipelines &mPipelines;
+        int mNotify = -1;
+    };
+#endif
 }
@@ -0,0 +1,221 @@
+#include "VertexWriter.hpp"
+
+namespace rise::util {
+    namespace {
+        constexpr Size blockSize = 256;
+
+        Size streamComponents(MeshAttribute attribute) {
+            return attribute == MeshAttribute::Color ? 4 : 3;
+        }
+
+        Size encodedComponents(MeshAttribute attribute, AttributeEncoding encoding) {
+            return encoding == AttributeEncoding::Octahedral ? 2 : streamComponents(attribute);
+        }
+
+        span<float const> selectStream(VertexStreams const &streams, MeshAttribute attribute) {
+            auto floats = [](auto stream) {
+                return span<float const>(reinterpret_cast<float const *>(stream.data()),
+                        stream.size_bytes() / sizeof(float));
+            };
+
+            switch (attribute) {
+                case MeshAttribute::Position:
+                    return floats(streams.positions);
+                case MeshAttribute::Normal:
+                    return floats(streams.normals);
+                case MeshAttribute::TextCoord:
+                    return floats(streams.textCoords);
+                case MeshAttribute::Color:
+                    return floats(streams.colors);
+            }
+            throw std::runtime_error("not implemented attribute!");
+        }
+
+        float signNotZero(float value) {
+            return value >= 0.f ? 1.f : -1.f;
+        }
+
+        // unit vector folded onto the octahedron and unwrapped to [-1, 1]^2
+        glm::vec2 octahedralEncode(glm::vec3 n) {
+            auto sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            if (sum == 0.f) {
+                return {0.f, 0.f};
+            }
+            n = n * (1.f / sum);
+            if (n.z < 0.f) {
+                return {(1.f - std::abs(n.y)) * signNotZero(n.x), (1.f - std::abs(n.x)) * signNotZero(n.y)};
+            }
+            return {n.x, n.y};
+        }
+
+        glm::vec3 octahedralDecode(glm::vec2 e) {
+            glm::vec3 n(e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y));
+            auto fold = std::max(-n.z, 0.f);
+            n.x += n.x >= 0.f ? -fold : fold;
+            n.y += n.y >= 0.f ? -fold : fold;
+            return glm::normalize(n);
+        }
+
+        bool signedFormat(Format format) {
+            auto numeric = formatInfo(format).numeric;
+            return numeric == NumericClass::Snorm || numeric == NumericClass::Sscaled
+                    || numeric == NumericClass::Sint || numeric == NumericClass::Sfloat;
+        }
+    }
+
+    VertexWriter::VertexWriter(vector<MeshConvertOp> const &ops) {
+        Size boundsRelative = 0;
+        for (auto const &op : ops) {
+            if (op.encoding == AttributeEncoding::BoundsRelative) {
+                if (op.type != MeshAttribute::Position || ++boundsRelative > 1) {
+                    throw std::runtime_error("bounds relative encoding needs a single position attribute");
+                }
+                mSignedPositions = signedFormat(op.format);
+            }
+            if (op.encoding == AttributeEncoding::Octahedral && op.type != MeshAttribute::Normal) {
+                throw std::runtime_error("octahedral encoding is for normals only");
+            }
+
+            auto kernel = encodeKernel(op.format, encodedComponents(op.type, op.encoding));
+            mSteps.push_back({op.type, op.encoding, kernel, decodeKernel(op.format), mVertexSize,
+                    formatSize(op.format)});
+            mVertexSize += formatSize(op.format);
+        }
+    }
+
+    void VertexWriter::setPositionBounds(glm::vec3 const &min, glm::vec3 const &max) {
+        if (ranges::none_of(mSteps, [](auto const &step) { return step.encoding == AttributeEncoding::BoundsRelative; })) {
+            return;
+        }
+
+        // unsigned formats cover [0, 1] from min to max, signed ones [-1, 1] around the center
+        auto extent = max - min;
+        for (int axis = 0; axis != 3; ++axis) {
+            if (extent[axis] <= 0.f) {
+                extent[axis] = 1.f;
+            }
+        }
+
+        if (mSignedPositions) {
+            mPositions.scale = extent * 0.5f;
+            mPositions.offset = (min + max) * 0.5f;
+        } else {
+            mPositions.scale = extent;
+            mPositions.offset = min;
+        }
+    }
+
+    void VertexWriter::write(VertexStreams const &streams, Size vertexCount, uint8_t *dst) const {
+        for (auto const &step : mSteps) {
+            if (selectStream(streams, step.attribute).size() < vertexCount * streamComponents(step.attribute)) {
+                spdlog::warn("Mesh has no attribute {}, filled with zeros", toString(step.attribute));
+            }
+        }
+
+        auto inverseScale = glm::vec3(1.f) / mPositions.scale;
+        std::array<float, blockSize * 3> encoded;
+
+        for (Size first = 0; first < vertexCount; first += blockSize) {
+            auto count = std::min(blockSize, vertexCount - first);
+            auto block = dst + first * mVertexSize;
+
+            for (auto const &step : mSteps) {
+                auto components = streamComponents(step.attribute);
+                auto stream = selectStream(streams, step.attribute);
+                if (stream.size() < (first + count) * components) {
+                    for (Size i = 0; i != count; ++i) {
+                        memset(block + i * mVertexSize + step.offset, 0, step.size);
+                    }
+                    continue;
+                }
+
+                auto src = stream.data() + first * components;
+                switch (step.encoding) {
+                    case AttributeEncoding::Direct:
+                        break;
+                    case AttributeEncoding::BoundsRelative:
+                        for (Size i = 0; i != count; ++i) {
+                            glm::vec3 p(src[i * 3], src[i * 3 + 1], src[i * 3 + 2]);
+                            auto q = (p - mPositions.offset) * inverseScale;
+                            encoded[i * 3] = q.x;
+                            encoded[i * 3 + 1] = q.y;
+                            encoded[i * 3 + 2] = q.z;
+                        }
+                        src = encoded.data();
+                        break;
+                    case AttributeEncoding::Octahedral:
+                        for (Size i = 0; i != count; ++i) {
+                            auto e = octahedralEncode({src[i * 3], src[i * 3 + 1], src[i * 3 + 2]});
+                            encoded[i * 2] = e.x;
+                            encoded[i * 2 + 1] = e.y;
+                        }
+                        src = encoded.data();
+                        break;
+                }
+                step.kernel(src, count, block + step.offset, mVertexSize);
+            }
+        }
+    }
+
+    vector<glm::vec3> VertexWriter::decodePositions(uint8_t const *vertices, Size vertexCount) const {
+        for (auto const &step : mSteps) {
+            if (step.attribute != MeshAttribute::Position) {
+                continue;
+            }
+
+            vector<glm::vec4> decoded(vertexCount);
+            step.decode(vertices + step.offset, mVertexSize, vertexCount, decoded.data());
+
+            vector<glm::vec3> positions(vertexCount);
+            ranges::transform(decoded, positions.begin(), [this](auto const &p) {
+                return glm::vec3(p) * mPositions.scale + mPositions.offset;
+            });
+            return positions;
+        }
+        return {};
+    }
+
+    QuantizationError VertexWriter::measureError(VertexStreams const &streams, Size vertexCount,
+            uint8_t const *vertices) const {
+        QuantizationError error;
+        vector<glm::vec4> decoded(vertexCount);
+
+        for (auto const &step : mSteps) {
+            auto stream = selectStream(streams, step.attribute);
+            if (stream.size() < vertexCount * streamComponents(step.attribute)) {
+                continue;
+            }
+            step.decode(vertices + step.offset, mVertexSize, vertexCount, decoded.data());
+
+            for (Size i = 0; i != vertexCount; ++i) {
+                glm::vec3 source(stream[i * 3], stream[i * 3 + 1], stream[i * 3 + 2]);
+                auto const &value = decoded[i];
+
+                switch (step.attribute) {
+                    case MeshAttribute::Position:
+                        error.position = std::max(error.position,
+                                glm::distance(source, glm::vec3(value) * mPositions.scale + mPositions.offset));
+                        break;
+                    case MeshAttribute::Normal: {
+                        if (glm::length(source) == 0.f) {
+                            break;
+                        }
+                        auto normal = step.encoding == AttributeEncoding::Octahedral
+                                ? octahedralDecode({value.x, value.y}) : glm::normalize(glm::vec3(value));
+                        auto cosine = std::clamp(glm::dot(glm::normalize(source), normal), -1.f, 1.f);
+                        error.normalDegrees = std::max(error.normalDegrees, glm::degrees(std::acos(cosine)));
+                        break;
+                    }
+                    case MeshAttribute::TextCoord:
+                        error.textCoord = std::max({error.textCoord, std::abs(source.x - value.x),
+                                std::abs(source.y - value.y)});
+                        break;
+                    case MeshAttribute::Color:
+                        break;
+                }
+            }
+        }
+
+        return error;
+    }
+}
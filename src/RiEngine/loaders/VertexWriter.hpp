@@ -0,0 +1,60 @@
+#pragma once
+#include "MeshLoader.hpp"
+#include "../FormatPacking.hpp"
+
+namespace rise::util {
+    struct VertexStreams {
+        span<glm::vec3 const> positions;
+        span<glm::vec3 const> normals;
+        span<glm::vec3 const> textCoords;
+        span<glm::vec4 const> colors;
+    };
+
+    // Largest difference between source attributes and what the written vertices decode to
+    struct QuantizationError {
+        float position = 0.f;
+        float normalDegrees = 0.f;
+        float textCoord = 0.f;
+    };
+
+    // Convert ops compiled once into a kernel per attribute. Vertices are written in blocks small
+    // enough to stay in cache, so the interleaved destination is filled in a single pass.
+    class VertexWriter {
+    public:
+        explicit VertexWriter(vector<MeshConvertOp> const &ops);
+
+        Size vertexSize() const {
+            return mVertexSize;
+        }
+
+        // Range bounds relative positions are mapped from, call before write
+        void setPositionBounds(glm::vec3 const &min, glm::vec3 const &max);
+
+        PositionQuantization positionQuantization() const {
+            return mPositions;
+        }
+
+        // dst must have room for vertexCount * vertexSize() bytes
+        void write(VertexStreams const &streams, Size vertexCount, uint8_t *dst) const;
+
+        // Positions of written vertices in mesh space, empty without a position attribute
+        vector<glm::vec3> decodePositions(uint8_t const *vertices, Size vertexCount) const;
+
+        QuantizationError measureError(VertexStreams const &streams, Size vertexCount, uint8_t const *vertices) const;
+
+    private:
+        struct Step {
+            MeshAttribute attribute;
+            AttributeEncoding encoding;
+            EncodeKernel kernel;
+            DecodeKernel decode;
+            Offset offset;
+            Size size;
+        };
+
+        vector<Step> mSteps;
+        Size mVertexSize = 0;
+        bool mSignedPositions = false;
+        PositionQuantization mPositions;
+    };
+}
@@ -17,11 +17,21 @@
 #include <cassert>
 #include <stdexcept>
 #include <span>
+#include <array>
 #include <RiUtil.hpp>
 #include <spdlog/spdlog.h>
 #include <ranges>
 #include <set>
 #include <concepts>
+#include <numeric>
+#include <bit>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <memory>
 
 namespace rise {
     namespace fs = std::filesystem;
@@ -0,0 +1,115 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include "spdlog/sinks/null_sink.h"
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+constexpr Size drawCount = 100000;
+
+fs::path const benchFolder = "game/benchPlanner";
+
+vector<string> const meshes = {"cube", "sphere"};
+vector<string> const groups = {"phong", "flat", "shadow", "depth"};
+
+MeshDrawPlanner loadPlanner(vector<uint8_t> &vertices, vector<uint8_t> &indices) {
+    MeshConverter converter;
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    for (auto const &mesh : meshes) {
+        converter.load("objMeshes/" + mesh + ".obj", mesh);
+    }
+
+    auto dst = benchFolder / "meshes";
+    fs::create_directories(dst);
+    converter.convert(dst);
+
+    MeshImporter importer(benchFolder, meshes);
+    vertices.resize(importer.sizeForVertices());
+    indices.resize(importer.sizeForIndices());
+    return importer.load(MemData(vertices), MemData(indices));
+}
+
+template<typename Draw>
+double benchDraws(Draw &&draw) {
+    auto start = time::steady_clock::now();
+    for (Size i = 0; i != drawCount; ++i) {
+        draw(i);
+    }
+    time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template<typename Frame>
+double benchFrames(Frame &&frame) {
+    constexpr Size frameCount = 16;
+
+    auto start = time::steady_clock::now();
+    for (Size i = 0; i != frameCount; ++i) {
+        frame();
+    }
+    time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+    return elapsed.count() / frameCount;
+}
+
+int main() {
+    try {
+        spdlog::set_default_logger(spdlog::null_logger_mt("bench-logger"));
+
+        vector<uint8_t> vertices, indices;
+        auto planner = loadPlanner(vertices, indices);
+
+        auto byName = benchDraws([&](Size i) {
+            planner.draw(meshes[i % meshes.size()], groups[i % groups.size()]);
+        });
+
+        vector<MeshHandle> meshHandles;
+        for (auto const &mesh : meshes) {
+            meshHandles.push_back(planner.mesh(mesh));
+        }
+        vector<GroupHandle> groupHandles;
+        for (auto const &group : groups) {
+            groupHandles.push_back(planner.group(group));
+        }
+
+        auto byHandle = benchDraws([&](Size i) {
+            planner.draw(meshHandles[i % meshHandles.size()], groupHandles[i % groupHandles.size()]);
+        });
+
+        cout << drawCount << " draws\tby name: " << byName << " ms\tby handle: " << byHandle
+             << " ms\tspeedup: " << byName / byHandle << endl;
+
+        auto replanned = benchFrames([&] {
+            planner.reset();
+            for (Size i = 0; i != drawCount; ++i) {
+                planner.draw(meshHandles[i % meshHandles.size()], groupHandles[i % groupHandles.size()]);
+            }
+            planner.finalize();
+        });
+        auto retained = benchFrames([&] {
+            planner.finalize();
+        });
+
+        cout << "frame\treplanned: " << replanned << " ms\tretained: " << retained << " ms" << endl;
+
+        ThreadPool pool;
+        auto chunkCount = pool.threadCount() * 4;
+        auto recorders = planner.recorders(chunkCount);
+        auto recorded = benchFrames([&] {
+            planner.reset();
+            pool.parallelFor(chunkCount, [&](Size chunk) {
+                for (Size i = chunk; i < drawCount; i += chunkCount) {
+                    recorders[chunk].draw(meshHandles[i % meshHandles.size()], groupHandles[i % groupHandles.size()]);
+                }
+            });
+            planner.merge();
+            planner.finalize();
+        });
+
+        cout << "frame\trecorded on " << pool.threadCount() << " threads: " << recorded << " ms" << endl;
+
+    } catch (std::exception const &ex) {
+        cerr << "--------------EXCEPTION---------------" << endl;
+        cerr << ex.what() << endl;
+        return 1;
+    }
+}
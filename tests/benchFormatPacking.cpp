@@ -0,0 +1,72 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include <magic_enum.hpp>
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+// the vertex writer packs blocks of 256 elements that stay in cache
+constexpr Size blockSize = 256;
+constexpr Size blockRepeats = 4096;
+constexpr Size streamCount = 1 << 22;
+constexpr Size repeats = 8;
+
+template<typename F>
+double measure(F &&func) {
+    auto best = std::numeric_limits<double>::max();
+    for (Size i = 0; i != repeats; ++i) {
+        auto start = time::steady_clock::now();
+        func();
+        time::duration<double, std::nano> elapsed = time::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void bench(Format format, Size srcComponents, span<float const> src) {
+    auto kernel = encodeKernel(format, srcComponents);
+    // interleaved into a vertex larger than the format, as attributes are written
+    auto stride = formatSize(format) + 16;
+
+    vector<uint8_t> block(blockSize * stride);
+    auto blockNs = measure([&] {
+        for (Size i = 0; i != blockRepeats; ++i) {
+            kernel(src.data(), blockSize, block.data(), stride);
+        }
+    }) / double(blockSize * blockRepeats);
+
+    vector<uint8_t> stream(streamCount * stride);
+    auto streamNs = measure([&] {
+        kernel(src.data(), streamCount, stream.data(), stride);
+    }) / double(streamCount);
+
+    cout << magic_enum::enum_name(format) << " from " << srcComponents << "\tcached: " << blockNs
+         << " ns\tstreamed: " << streamNs << " ns per element" << endl;
+}
+
+int main() {
+    try {
+        vector<float> src(streamCount * 4);
+        for (Size i = 0; i != src.size(); ++i) {
+            src[i] = float(int(i % 2001) - 1000) / 997.f;
+        }
+
+        bench(Format::R16G16Sfloat, 2, src);
+        bench(Format::R16G16Sfloat, 3, src);
+        bench(Format::R16G16Snorm, 2, src);
+        bench(Format::R8G8Snorm, 2, src);
+        bench(Format::R8G8B8A8Unorm, 4, src);
+        bench(Format::R8G8B8A8Snorm, 4, src);
+        bench(Format::B8G8R8A8Unorm, 4, src);
+        bench(Format::R16G16B16A16Snorm, 4, src);
+        bench(Format::R16G16B16A16Unorm, 3, src);
+        bench(Format::R32G32B32Sfloat, 3, src);
+        bench(Format::R32G32Sfloat, 3, src);
+        bench(Format::R8G8B8A8Srgb, 4, src);
+
+    } catch (std::exception const &ex) {
+        cerr << "--------------EXCEPTION---------------" << endl;
+        cerr << ex.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,90 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include "spdlog/sinks/null_sink.h"
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+constexpr Size copiesPerSource = 64;
+
+vector<fs::path> const sources = {
+        "objMeshes/cube.obj",
+        "objMeshes/sphere.obj",
+};
+
+void fillConverter(MeshConverter &converter) {
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    converter.addConvertOp({"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat});
+
+    for (Size copy = 0; copy != copiesPerSource; ++copy) {
+        for (auto const &source : sources) {
+            converter.enqueue(source, source.stem().string() + std::to_string(copy));
+        }
+    }
+}
+
+double benchConvert(Size threadCount) {
+    ThreadPool pool(threadCount);
+    MeshConverter converter;
+    fillConverter(converter);
+
+    auto start = time::steady_clock::now();
+    converter.loadQueued(pool);
+    time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+
+    auto dst = fs::path("game/bench") / std::to_string(threadCount);
+    fs::create_directories(dst);
+    converter.convert(dst);
+
+    return elapsed.count();
+}
+
+double benchCached(ThreadPool &pool) {
+    MeshConverter converter;
+    converter.setCache("game/benchCache");
+    fillConverter(converter);
+
+    auto start = time::steady_clock::now();
+    converter.loadQueued(pool);
+    auto dst = fs::path("game/bench") / "cached";
+    fs::create_directories(dst);
+    converter.convert(dst);
+    time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+int main() {
+    try {
+        spdlog::set_default_logger(spdlog::null_logger_mt("bench-logger"));
+
+        auto maxThreads = std::max(Size(std::thread::hardware_concurrency()), Size(1));
+        auto meshCount = copiesPerSource * sources.size();
+
+        cout << "Converting " << meshCount << " meshes" << endl;
+
+        double single = 0;
+        for (Size threads = 1; threads <= maxThreads; threads = threads == maxThreads ? threads + 1
+                : std::min(threads * 2, maxThreads)) {
+            auto ms = benchConvert(threads);
+            if (threads == 1) {
+                single = ms;
+            }
+
+            cout << "threads: " << threads << "\ttime: " << ms << " ms\tspeedup: "
+                 << single / ms << endl;
+        }
+
+        fs::remove_all("game/benchCache");
+        ThreadPool pool;
+        auto firstRun = benchCached(pool);
+        auto cachedRun = benchCached(pool);
+        cout << "conversion cache\tfirst run: " << firstRun << " ms\tunchanged rerun: " << cachedRun
+             << " ms" << endl;
+
+    } catch (std::exception const &ex) {
+        cerr << "--------------EXCEPTION---------------" << endl;
+        cerr << ex.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,131 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "spdlog/sinks/null_sink.h"
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+constexpr Size copiesPerSource = 128;
+
+fs::path const benchFolder = "game/benchImport";
+
+vector<fs::path> const sources = {
+        "objMeshes/cube.obj",
+        "objMeshes/sphere.obj",
+};
+
+struct Layout {
+    string name;
+    MeshStorage storage;
+};
+
+vector<Layout> const layouts = {
+        {"files", MeshStorage::Files},
+        {"archive", MeshStorage::Archive},
+        {"compressed", MeshStorage::CompressedArchive},
+};
+
+vector<string> convertMeshes() {
+    ThreadPool pool;
+    MeshConverter converter;
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    converter.addConvertOp({"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat});
+
+    vector<string> names;
+    for (Size copy = 0; copy != copiesPerSource; ++copy) {
+        for (auto const &source : sources) {
+            names.push_back(source.stem().string() + std::to_string(copy));
+            converter.enqueue(source, names.back());
+        }
+    }
+    converter.loadQueued(pool);
+
+    for (auto const &layout : layouts) {
+        auto dst = benchFolder / layout.name / "meshes";
+        fs::create_directories(dst);
+        converter.convert(dst, layout.storage);
+    }
+
+    return names;
+}
+
+Size folderSize(fs::path const &folder) {
+    Size size = 0;
+    for (auto const &entry : fs::recursive_directory_iterator(folder)) {
+        if (entry.is_regular_file() && entry.path().filename() != "manifest.rise") {
+            size += entry.file_size();
+        }
+    }
+    return size;
+}
+
+// only clean pages are dropped, which is all the converted files have after the first sync
+void dropPageCache() {
+    sync();
+    for (auto const &entry : fs::recursive_directory_iterator(benchFolder)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        auto fd = open(entry.path().c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+template<typename Load>
+double benchLoad(fs::path const &folder, vector<string> const &names, bool cold, Load &&load) {
+    if (cold) {
+        dropPageCache();
+    }
+
+    auto start = time::steady_clock::now();
+
+    MeshImporter importer(folder, names);
+    vector<uint8_t> vertices(importer.sizeForVertices());
+    vector<uint8_t> indices(importer.sizeForIndices());
+    load(importer, MemData(vertices), MemData(indices));
+
+    time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main() {
+    try {
+        spdlog::set_default_logger(spdlog::null_logger_mt("bench-logger"));
+
+        auto names = convertMeshes();
+        cout << "Importing " << names.size() << " meshes" << endl;
+
+        ThreadPool pool;
+
+        auto serial = [](MeshImporter &importer, MemData vertices, MemData indices) {
+            importer.load(vertices, indices);
+        };
+        auto parallel = [&pool](MeshImporter &importer, MemData vertices, MemData indices) {
+            importer.loadAsync(vertices, indices, pool).get();
+        };
+
+        for (auto const &layout : layouts) {
+            auto folder = benchFolder / layout.name;
+            cout << layout.name << ": " << folderSize(folder) << " bytes on disk" << endl;
+
+            for (auto cold : {true, false}) {
+                auto serialMs = benchLoad(folder, names, cold, serial);
+                auto parallelMs = benchLoad(folder, names, cold, parallel);
+
+                cout << "\t" << (cold ? "cold" : "warm") << " cache\tserial: " << serialMs << " ms\tasync on "
+                     << pool.threadCount() << " threads: " << parallelMs << " ms\tspeedup: "
+                     << serialMs / parallelMs << endl;
+            }
+        }
+
+    } catch (std::exception const &ex) {
+        cerr << "--------------EXCEPTION---------------" << endl;
+        cerr << ex.what() << endl;
+        return 1;
+    }
+}
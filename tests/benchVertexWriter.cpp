@@ -0,0 +1,129 @@
+#include <RiEngine.hpp>
+#include <RiEngine/loaders/VertexWriter.hpp>
+#include <iostream>
+
+using namespace rise;
+using namespace rise::util;
+using std::cout, std::endl, std::cerr;
+
+constexpr Size vertexCount = 1 << 22;
+constexpr Size repeats = 8;
+
+// per vertex, per attribute path the writer replaced
+namespace reference {
+    template<typename T>
+    void writeToBuffer(binary::vector<uint8_t> &buffer, T const &obj) {
+        auto currentPos = buffer.size();
+        buffer.resize(currentPos + sizeof(T));
+        memcpy(buffer.data() + currentPos, &obj, sizeof(T));
+    }
+
+    void writeAttrib(binary::vector<uint8_t> &data, Format format, glm::vec3 vec) {
+        switch (format) {
+            case Format::R32G32B32Sfloat:
+                return writeToBuffer(data, vec);
+            case Format::R32G32Sfloat:
+                return writeToBuffer(data, glm::vec2(vec.x, vec.y));
+            default:
+                throw std::runtime_error("not implemented format!");
+        }
+    }
+
+    void writeVertices(VertexStreams const &streams, vector<MeshConvertOp> const &ops,
+            binary::vector<uint8_t> &data) {
+        for (size_t i = 0; i != vertexCount; ++i) {
+            for (auto const &op : ops) {
+                switch (op.type) {
+                    case MeshAttribute::Position:
+                        writeAttrib(data, op.format, streams.positions[i]);
+                        break;
+                    case MeshAttribute::Normal:
+                        writeAttrib(data, op.format, streams.normals[i]);
+                        break;
+                    case MeshAttribute::TextCoord:
+                        writeAttrib(data, op.format, streams.textCoords[i]);
+                        break;
+                    default:
+                        throw std::runtime_error("not implemented format!");
+                }
+            }
+        }
+    }
+}
+
+template<typename F>
+double measure(F &&func) {
+    auto best = std::numeric_limits<double>::max();
+    for (Size i = 0; i != repeats; ++i) {
+        auto start = time::steady_clock::now();
+        func();
+        time::duration<double, std::milli> elapsed = time::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void bench(string_view name, vector<MeshConvertOp> const &ops, VertexStreams const &streams) {
+    VertexWriter writer(ops);
+
+    auto referenceMs = measure([&] {
+        binary::vector<uint8_t> data;
+        reference::writeVertices(streams, ops, data);
+    });
+
+    auto writerMs = measure([&] {
+        binary::vector<uint8_t> data;
+        data.resize(vertexCount * writer.vertexSize());
+        writer.write(streams, vertexCount, data.data());
+    });
+
+    cout << name << "\treference: " << referenceMs << " ms\twriter: " << writerMs
+         << " ms\tspeedup: " << referenceMs / writerMs << endl;
+}
+
+void benchPreset(string_view name, QuantizationPreset preset, VertexStreams const &streams) {
+    VertexWriter writer(quantizedOps(preset));
+    writer.setPositionBounds(streams.positions.front(), streams.positions.back());
+
+    vector<uint8_t> data(vertexCount * writer.vertexSize());
+    auto writerMs = measure([&] {
+        writer.write(streams, vertexCount, data.data());
+    });
+    auto error = writer.measureError(streams, vertexCount, data.data());
+
+    cout << name << "	" << writer.vertexSize() << " bytes	writer: " << writerMs << " ms	error position: "
+         << error.position << " normal: " << error.normalDegrees << " deg uv: " << error.textCoord << endl;
+}
+
+int main() {
+    try {
+        vector<glm::vec3> positions(vertexCount), normals(vertexCount), textCoords(vertexCount);
+        for (Size i = 0; i != vertexCount; ++i) {
+            positions[i] = glm::vec3(float(i), float(i) * 0.5f, float(i) * 0.25f);
+            normals[i] = glm::normalize(glm::vec3(1.f, float(i % 7), float(i % 13)));
+            textCoords[i] = glm::vec3(float(i % 256) / 256.f, float(i % 128) / 128.f, 0.f);
+        }
+
+        VertexStreams streams{positions, normals, textCoords, {}};
+
+        cout << "Writing " << vertexCount << " vertices" << endl;
+
+        bench("position", {
+                {"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat},
+        }, streams);
+
+        bench("position normal uv", {
+                {"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat},
+                {"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat},
+                {"inTextCoords", MeshAttribute::TextCoord, Format::R32G32Sfloat},
+        }, streams);
+
+        benchPreset("quality preset", QuantizationPreset::Quality, streams);
+        benchPreset("compact preset", QuantizationPreset::Compact, streams);
+
+    } catch (std::exception const &ex) {
+        cerr << "--------------EXCEPTION---------------" << endl;
+        cerr << ex.what() << endl;
+        return 1;
+    }
+}
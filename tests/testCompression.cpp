@@ -0,0 +1,68 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include <random>
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+// float positions on a grid, the kind of data vertex blobs hold
+vector<uint8_t> gridVertices(Size count) {
+    vector<uint8_t> data(count * sizeof(glm::vec3));
+    for (Size i = 0; i != count; ++i) {
+        glm::vec3 position(float(i % 64), float(i / 64 % 64), float(i / 4096));
+        memcpy(data.data() + i * sizeof(position), &position, sizeof(position));
+    }
+    return data;
+}
+
+int main() {
+    Size failed = 0;
+
+    std::mt19937 random(11);
+    vector<pair<string, vector<uint8_t>>> inputs;
+    inputs.emplace_back("empty", vector<uint8_t>());
+    inputs.emplace_back("grid", gridVertices(10007));
+
+    vector<uint8_t> noise(100003);
+    for (auto &byte : noise) {
+        byte = uint8_t(random());
+    }
+    inputs.emplace_back("noise", noise);
+    inputs.emplace_back("runs", vector<uint8_t>(70000, 3));
+
+    for (auto const &[name, input] : inputs) {
+        // 5 leaves a partial element behind the transposed bytes
+        for (Size stride : {1, 2, 5, 12}) {
+            vector<uint8_t> compressed;
+            compressBlock(input, stride, compressed);
+
+            vector<uint8_t> decoded(input.size());
+            decompressBlock(compressed, stride, decoded);
+            if (decoded != input) {
+                cerr << name << " stride " << stride << ": decoded data differs" << endl;
+                ++failed;
+            }
+            if (compressed.size() > compressBound(input.size())) {
+                cerr << name << " stride " << stride << ": compressed size over bound" << endl;
+                ++failed;
+            }
+            if (stride == 12) {
+                cout << name << ": " << input.size() << " -> " << compressed.size() << " bytes" << endl;
+            }
+        }
+    }
+
+    vector<uint8_t> compressed;
+    compressBlock(inputs[1].second, 12, compressed);
+    compressed.resize(compressed.size() / 2);
+    vector<uint8_t> decoded(inputs[1].second.size());
+    try {
+        decompressBlock(compressed, 12, decoded);
+        cerr << "truncated block was decoded" << endl;
+        ++failed;
+    } catch (std::runtime_error const &) {
+    }
+
+    cout << (failed ? "FAILED" : "OK") << endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+#include <RiEngine.hpp>
+#include <RiEngine/loaders/MeshOptimizer.hpp>
+#include <iostream>
+#include <random>
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+// identity clip space is the box [-1, 1] on every axis
+bool insideUnitBox(glm::vec4 const &sphere) {
+    for (int axis = 0; axis != 3; ++axis) {
+        if (sphere[axis] + sphere.w < -1.f || sphere[axis] - sphere.w > 1.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a meshlet may only be culled from cameras that see none of its triangles from the front
+Size checkCone(vector<glm::vec3> const &positions, vector<uint32_t> const &indices, std::mt19937 &random) {
+    Size failed = 0;
+    auto meshlets = util::buildMeshlets(indices, positions, {});
+    if (meshlets.size() != 1) {
+        cerr << "coneBackfacing: expected a single meshlet" << endl;
+        return 1;
+    }
+    auto const &meshlet = meshlets.front();
+    glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+    glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+    auto culled = [&](glm::vec3 camera) {
+        return coneBackfacing(center, meshlet.radius, axis, meshlet.coneCutoff, camera);
+    };
+
+    std::uniform_real_distribution<float> coordinate(-6.f, 6.f);
+    Size culledCount = 0;
+    for (Size i = 0; i != 20000; ++i) {
+        glm::vec3 camera(coordinate(random), coordinate(random), coordinate(random));
+        if (!culled(camera)) {
+            continue;
+        }
+        ++culledCount;
+        for (Size t = 0; t != indices.size(); t += 3) {
+            auto a = positions[indices[t]], b = positions[indices[t + 1]], c = positions[indices[t + 2]];
+            if (glm::dot(glm::cross(b - a, c - a), camera - a) > 0.f) {
+                cerr << "coneBackfacing: culled a meshlet seen from the front" << endl;
+                return 1;
+            }
+        }
+    }
+    // the test must still cull from straight behind
+    if (culledCount == 0 || !culled(center - axis * 10.f)) {
+        cerr << "coneBackfacing: never culls" << endl;
+        ++failed;
+    }
+    return failed;
+}
+
+int main() {
+    Size failed = 0;
+
+    auto frustum = Frustum::fromMatrix(glm::mat4(1.f));
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(-3.f, 3.f), radius(0.f, 1.f);
+
+    // 1003 keeps a scalar tail after the SIMD batches
+    vector<glm::vec4> spheres(1003);
+    for (auto &sphere : spheres) {
+        sphere = {position(random), position(random), position(random), radius(random)};
+    }
+
+    vector<uint32_t> visible;
+    cullSpheres(frustum, spheres, visible);
+
+    vector<uint32_t> expected;
+    for (uint32_t i = 0; i != spheres.size(); ++i) {
+        if (insideUnitBox(spheres[i])) {
+            expected.push_back(i);
+        }
+    }
+    if (visible != expected) {
+        cerr << "cullSpheres: " << visible.size() << " visible, expected " << expected.size() << endl;
+        ++failed;
+    }
+
+    vector<glm::vec3> points = {{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
+    auto bounds = computeBounds(points);
+
+    vector<glm::mat4> transforms;
+    vector<uint32_t> expectedInstances;
+    for (uint32_t i = 0; i != spheres.size(); ++i) {
+        glm::mat4 transform(1.f);
+        auto scale = spheres[i].w + 0.5f;
+        for (int axis = 0; axis != 3; ++axis) {
+            transform[axis][axis] = scale;
+        }
+        transform[3] = glm::vec4(glm::vec3(spheres[i]), 1.f);
+        transforms.push_back(transform);
+
+        if (insideUnitBox(glm::vec4(glm::vec3(spheres[i]), bounds.radius * scale))) {
+            expectedInstances.push_back(i);
+        }
+    }
+
+    visible.clear();
+    cullInstances(frustum, bounds, transforms, visible);
+    if (visible != expectedInstances) {
+        cerr << "cullInstances: " << visible.size() << " visible, expected " << expectedInstances.size() << endl;
+        ++failed;
+    }
+
+    // collapsed to a point far outside, infinite bounds must still be visible
+    glm::mat4 collapsed(0.f);
+    collapsed[3] = glm::vec4(100.f, 0.f, 0.f, 1.f);
+    transforms.push_back(collapsed);
+
+    visible.clear();
+    cullInstances(frustum, Bounds::infinite(), transforms, visible);
+    if (visible.size() != transforms.size()) {
+        cerr << "infinite bounds were culled" << endl;
+        ++failed;
+    }
+
+    // two faces meeting in a valley, visible from (1.5, 0, -1.2) behind the cone apex
+    vector<glm::vec3> ridge = {{-1.f, 0.f, 0.f}, {0.f, 0.f, -0.5f}, {0.f, 1.f, -0.5f}, {1.f, 0.f, 0.f},
+            {-1.f, 1.f, 0.f}, {1.f, 1.f, 0.f}};
+    vector<uint32_t> ridgeIndices = {0, 1, 2, 0, 2, 4, 1, 3, 5, 1, 5, 2};
+    failed += checkCone(ridge, ridgeIndices, random);
+
+    // curved patch of a sphere cap facing +z
+    vector<glm::vec3> cap;
+    vector<uint32_t> capIndices;
+    for (int y = 0; y != 5; ++y) {
+        for (int x = 0; x != 5; ++x) {
+            float fx = x * 0.2f - 0.4f, fy = y * 0.2f - 0.4f;
+            cap.emplace_back(fx, fy, std::sqrt(1.f - fx * fx - fy * fy));
+        }
+    }
+    for (uint32_t y = 0; y != 4; ++y) {
+        for (uint32_t x = 0; x != 4; ++x) {
+            uint32_t i = y * 5 + x;
+            capIndices.insert(capIndices.end(), {i, i + 1, i + 6, i, i + 6, i + 5});
+        }
+    }
+    failed += checkCone(cap, capIndices, random);
+
+    cout << (failed ? "FAILED" : "OK") << endl;
+    return failed ? 1 : 0;
+}
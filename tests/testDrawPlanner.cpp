@@ -0,0 +1,88 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include "spdlog/sinks/null_sink.h"
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+fs::path const testFolder = "game/testPlanner";
+
+MeshDrawPlanner loadPlanner(vector<uint8_t> &vertices, vector<uint8_t> &indices) {
+    MeshConverter converter;
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    converter.setLods({});
+    converter.load("objMeshes/sphere.obj", "lodSphere");
+
+    auto dst = testFolder / "meshes";
+    fs::create_directories(dst);
+    converter.convert(dst);
+
+    MeshImporter importer(testFolder, {"lodSphere"});
+    vertices.resize(importer.sizeForVertices());
+    indices.resize(importer.sizeForIndices());
+    return importer.load(MemData(vertices), MemData(indices));
+}
+
+// neighbouring levels of one mesh are contiguous index ranges with the same vertex offset, they
+// must still be drawn by separate commands keeping every instance
+Size checkLevels(MeshDrawPlanner &planner) {
+    Size failed = 0;
+
+    auto mesh = planner.mesh("lodSphere");
+    if (planner.lodCount(mesh) < 2) {
+        cerr << "lodSphere has no coarser level" << endl;
+        return 1;
+    }
+
+    auto group = planner.group("levels");
+    planner.draw(mesh, group, 0);
+    planner.draw(mesh, group, 1);
+    planner.draw(mesh, group, 0);
+    planner.finalize();
+
+    auto const &format = *planner.begin();
+    auto const &drawGroup = *format.begin();
+    vector<MeshDrawInfo> draws(drawGroup.begin(), drawGroup.end());
+    auto commands = format.commands(drawGroup);
+    vector<uint32_t> instanceDraws(format.instanceDraws().begin(), format.instanceDraws().end());
+
+    if (commands.size() != 2) {
+        cerr << "expected 2 commands, got " << commands.size() << endl;
+        return 1;
+    }
+    for (Size level = 0; level != 2; ++level) {
+        auto const &draw = draws[level];
+        auto const &command = commands[level];
+        if (command.firstIndex != draw.firstIndex || command.indexCount != draw.indexCount
+                || command.vertexOffset != int32_t(draw.vertexOffset)) {
+            cerr << "command " << level << " does not draw level " << level << endl;
+            ++failed;
+        }
+    }
+    if (commands[0].instanceCount != 2 || commands[1].instanceCount != 1) {
+        cerr << "wrong instance counts " << commands[0].instanceCount << ", " << commands[1].instanceCount << endl;
+        ++failed;
+    }
+    if (instanceDraws != vector<uint32_t>{0, 2, 1}) {
+        cerr << "instance draws lost or reordered" << endl;
+        ++failed;
+    }
+    return failed;
+}
+
+int main() {
+    try {
+        spdlog::set_default_logger(spdlog::null_logger_mt("test-logger"));
+
+        vector<uint8_t> vertices, indices;
+        auto planner = loadPlanner(vertices, indices);
+
+        auto failed = checkLevels(planner);
+        cout << (failed == 0 ? "OK" : "FAILED") << endl;
+        return failed == 0 ? 0 : 1;
+    } catch (std::exception const &ex) {
+        cerr << ex.what() << endl;
+        cout << "FAILED" << endl;
+        return 1;
+    }
+}
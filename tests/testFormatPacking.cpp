@@ -0,0 +1,139 @@
+#include <RiEngine.hpp>
+#include <iostream>
+#include <magic_enum.hpp>
+#include <glm/gtc/packing.hpp>
+#include <random>
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+struct PackCase {
+    Format format;
+    glm::vec4 value;
+    glm::vec4 expected;
+    Size components;
+    float tolerance;
+};
+
+vector<PackCase> const cases = {
+        {Format::R8G8B8A8Unorm, {0.2f, 0.4f, 0.6f, 0.8f}, {0.2f, 0.4f, 0.6f, 0.8f}, 4, 1.f / 255.f},
+        {Format::R8G8B8A8Unorm, {-1.f, 2.f, 0.f, 1.f}, {0.f, 1.f, 0.f, 1.f}, 4, 0.f},
+        {Format::B8G8R8A8Unorm, {0.1f, 0.5f, 0.9f, 1.f}, {0.1f, 0.5f, 0.9f, 1.f}, 4, 1.f / 255.f},
+        {Format::R8G8B8A8Srgb, {0.05f, 0.5f, 1.f, 0.5f}, {0.05f, 0.5f, 1.f, 0.5f}, 4, 0.01f},
+        {Format::R8G8Snorm, {-0.5f, 1.f, 0.f, 1.f}, {-0.5f, 1.f, 0.f, 1.f}, 2, 1.f / 127.f},
+        {Format::R16G16B16A16Snorm, {-0.5f, 0.25f, 1.f, -1.f}, {-0.5f, 0.25f, 1.f, -1.f}, 4, 1.f / 32767.f},
+        {Format::R16G16B16A16Unorm, {0.f, 0.3f, 0.7f, 1.f}, {0.f, 0.3f, 0.7f, 1.f}, 4, 1.f / 65535.f},
+        {Format::R16G16Sfloat, {1.5f, -2.25f, 0.f, 1.f}, {1.5f, -2.25f, 0.f, 1.f}, 2, 0.f},
+        {Format::R16G16B16Uscaled, {3.f, 300.4f, -5.f, 1.f}, {3.f, 300.f, 0.f, 1.f}, 3, 0.f},
+        {Format::R8Sint, {-7.6f, 0.f, 0.f, 1.f}, {-8.f, 0.f, 0.f, 1.f}, 1, 0.f},
+        {Format::R32G32B32Sfloat, {1.f, -2.f, 3.5f, 1.f}, {1.f, -2.f, 3.5f, 1.f}, 3, 0.f},
+        {Format::R32G32B32A32Uint, {1.f, 2.f, 3e9f, -1.f}, {1.f, 2.f, 3e9f, 0.f}, 4, 0.f},
+        {Format::R64G64Sfloat, {0.125f, -8.f, 0.f, 1.f}, {0.125f, -8.f, 0.f, 1.f}, 2, 0.f},
+        {Format::D24UnormS8Uint, {0.5f, 3.f, 0.f, 1.f}, {0.5f, 3.f, 0.f, 1.f}, 2, 1.f / 16777215.f},
+        {Format::D32SfloatS8Uint, {0.25f, 200.f, 0.f, 1.f}, {0.25f, 200.f, 0.f, 1.f}, 2, 0.f},
+};
+
+// every component of normalized and half formats, written independently of the kernels: rounding
+// half away from zero, NaN to the lowest value
+uint32_t referenceComponent(FormatInfo const &info, float value) {
+    if (info.numeric == NumericClass::Sfloat) {
+        return glm::packHalf1x16(value);
+    }
+
+    bool isSigned = info.numeric == NumericClass::Snorm;
+    auto highest = double((1u << (info.bits[0] - isSigned)) - 1u);
+    if (std::isnan(value)) {
+        return isSigned ? uint32_t(-highest - 1) : 0u;
+    }
+    auto clamped = std::clamp(value, isSigned ? -1.f : 0.f, 1.f);
+    return uint32_t(std::lround(double(clamped * float(highest))));
+}
+
+// batch kernels must pack every element exactly like the reference, with rounding ties, values out
+// of range, half denormals and overflows among the elements
+Size checkBatches() {
+    Size failed = 0;
+
+    vector<float> values = {0.f, -0.f, 1.f, -1.f, 2.f, -2.f, 1e-30f, 1e-6f, -3e-5f, 6.1e-5f, 65504.f, 65519.f,
+            65520.f, -1e9f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::quiet_NaN()};
+    for (float highest : {127.f, 255.f, 32767.f, 65535.f}) {
+        for (int k = -300; k <= 300; ++k) {
+            values.push_back((float(k) + 0.5f) / highest);
+        }
+    }
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> distribution(-1.5f, 1.5f);
+    for (Size i = 0; i != 4000; ++i) {
+        values.push_back(distribution(random));
+    }
+
+    for (auto const &info : formatInfos) {
+        bool normalized = info.numeric == NumericClass::Unorm || info.numeric == NumericClass::Snorm;
+        bool half = info.numeric == NumericClass::Sfloat && info.bits[0] == 16;
+        if (info.depth || !(half || (normalized && info.bits[0] <= 16))) {
+            continue;
+        }
+
+        auto componentSize = Size(info.bits[0] / 8);
+        auto stride = info.size + 3;
+        for (Size srcComponents = 1; srcComponents <= 4; ++srcComponents) {
+            auto count = values.size() / srcComponents;
+            vector<uint8_t> packed(count * stride);
+            encodeKernel(info.format, srcComponents)(values.data(), count, packed.data(), stride);
+
+            Size mismatches = 0;
+            for (Size i = 0; i != count; ++i) {
+                for (Size c = 0; c != info.components; ++c) {
+                    auto source = info.bgr && c < 3 ? 2 - c : c;
+                    auto value = source < srcComponents ? values[i * srcComponents + source] : source == 3 ? 1.f : 0.f;
+                    uint32_t component = 0;
+                    memcpy(&component, packed.data() + i * stride + c * componentSize, componentSize);
+                    auto mask = componentSize == 1 ? 0xFFu : 0xFFFFu;
+                    mismatches += component != (referenceComponent(info, value) & mask);
+                }
+            }
+            if (mismatches) {
+                cerr << magic_enum::enum_name(info.format) << " from " << srcComponents << " components: "
+                     << mismatches << " components differ" << endl;
+                ++failed;
+            }
+        }
+    }
+    return failed;
+}
+
+int main() {
+    Size failed = checkBatches();
+
+    for (auto const &packCase : cases) {
+        vector<uint8_t> packed(formatSize(packCase.format));
+        encode(packCase.format, packCase.value, packed.data());
+        auto decoded = decode(packCase.format, packed.data());
+
+        for (Size c = 0; c != packCase.components; ++c) {
+            if (std::abs(decoded[c] - packCase.expected[c]) > packCase.tolerance) {
+                cerr << magic_enum::enum_name(packCase.format) << " component " << c << ": "
+                     << decoded[c] << " != " << packCase.expected[c] << endl;
+                ++failed;
+            }
+        }
+    }
+
+    // every format has encode and decode kernels and keeps zero
+    for (auto format : magic_enum::enum_values<Format>()) {
+        if (format == Format::Undefined) {
+            continue;
+        }
+
+        vector<uint8_t> packed(formatSize(format));
+        encode(format, glm::vec4(0.f, 0.f, 0.f, 1.f), packed.data());
+        if (decode(format, packed.data()).x != 0.f) {
+            cerr << magic_enum::enum_name(format) << " does not keep zero" << endl;
+            ++failed;
+        }
+    }
+
+    cout << (failed ? "FAILED" : "OK") << endl;
+    return failed ? 1 : 0;
+}
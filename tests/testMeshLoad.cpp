@@ -35,6 +35,9 @@ void convertNormals() {
     MeshConverter converter;
     converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
     converter.addConvertOp({"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat});
+    converter.setOptimization({});
+    converter.setMeshlets({});
+    converter.setLods({});
     converter.load("objMeshes/cube.obj", "normalsCube");
     converter.load("objMeshes/sphere.obj", "normalsSphere");
     converter.convert("game/meshes/withNormals");
@@ -48,9 +51,44 @@ void convertNoNormals() {
     converter.convert("game/meshes/noNormals");
 }
 
+void convertPacked() {
+    MeshConverter converter;
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    converter.addConvertOp({"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat});
+    converter.setMeshlets({});
+    converter.load("objMeshes/cube.obj", "packedCube");
+    converter.load("objMeshes/sphere.obj", "packedSphere");
+    fs::create_directories("game/meshes/packed");
+    converter.convert("game/meshes/packed", MeshStorage::Archive);
+}
+
+void convertCompressed() {
+    MeshConverter converter;
+    converter.addConvertOp({"inPositions", MeshAttribute::Position, Format::R32G32B32Sfloat});
+    converter.addConvertOp({"inNormals", MeshAttribute::Normal, Format::R32G32B32Sfloat});
+    converter.load("objMeshes/cube.obj", "compressedCube");
+    converter.load("objMeshes/sphere.obj", "compressedSphere");
+    fs::create_directories("game/meshes/compressed");
+    converter.convert("game/meshes/compressed", MeshStorage::CompressedArchive);
+}
+
+void convertQuantized() {
+    MeshConverter converter;
+    for (auto const &op : quantizedOps(QuantizationPreset::Compact)) {
+        converter.addConvertOp(op);
+    }
+    converter.setOptimization({});
+    converter.load("objMeshes/sphere.obj", "quantizedSphere");
+    fs::create_directories("game/meshes/quantized");
+    converter.convert("game/meshes/quantized");
+}
+
 void convert() {
     convertNormals();
     convertNoNormals();
+    convertPacked();
+    convertCompressed();
+    convertQuantized();
 }
 
 auto load(vector<uint8_t>& vout, vector<uint8_t>& iout) {
@@ -60,6 +98,11 @@ auto load(vector<uint8_t>& vout, vector<uint8_t>& iout) {
     meshes.emplace_back("noNormalsSphere");
     meshes.emplace_back("normalsCube");
     meshes.emplace_back("normalsSphere");
+    meshes.emplace_back("packedCube");
+    meshes.emplace_back("packedSphere");
+    meshes.emplace_back("compressedCube");
+    meshes.emplace_back("compressedSphere");
+    meshes.emplace_back("quantizedSphere");
 
     MeshImporter importer("game/meshes", meshes);
 
@@ -88,9 +131,22 @@ int main() {
 
         planner.draw("normalsSphere", "flat");
         planner.draw("noNormalsCube", "flat");
+        planner.draw("packedSphere", "flat");
         planner.draw("normalsCube", "flat");
         planner.draw("normalsCube", "flat");
         planner.draw("noNormalsSphere", "flat");
+        planner.draw("quantizedSphere", "flat");
+        planner.draw("compressedSphere", "phong");
+        planner.draw("normalsSphere", "flat", planner.selectLod("normalsSphere", 64.f));
+
+        cout << "normalsSphere LODs: " << planner.lodCount("normalsSphere") << endl;
+        cout << "normalsSphere radius: " << planner.bounds(planner.mesh("normalsSphere")).radius << endl;
+
+        auto quantization = planner.positionQuantization(planner.mesh("quantizedSphere"));
+        cout << "quantizedSphere position scale: " << quantization.scale.x << " offset: "
+             << quantization.offset.x << endl;
+
+        planner.finalize();
 
         for(auto const& format: planner) {
             cout << "Format has: ";
@@ -101,16 +157,32 @@ int main() {
                 cout << "normals ";
             }
             cout << endl;
+            cout << "Index size: " << indexSize(format.indexType()) << endl;
 
             for(auto const& group : format) {
                 cout << "\tGroup: " << group.name() << endl;
                 for(auto const& mesh : group) {
                     cout << "\t\tMesh first index: " << mesh.firstIndex << endl;
                     cout << "\t\tMesh index count: " << mesh.indexCount << endl;
+                    cout << "\t\tMesh vertex offset: " << mesh.vertexOffset << endl;
+                    cout << "\t\tMesh meshlets: " << format.meshlets(mesh).size() << endl;
+                    cout << "\t\tMesh LOD: " << mesh.lod << endl;
+                }
+                for(auto const& command : format.commands(group)) {
+                    cout << "\t\tCommand first index: " << command.firstIndex << " index count: "
+                         << command.indexCount << " instances: " << command.instanceCount << endl;
                 }
             }
         }
 
+        MeshImporter mappedImporter("game/meshes", {"packedCube", "normalsSphere"});
+        auto mapped = mappedImporter.mapMeshes();
+        for (auto name : {"packedCube", "normalsSphere"}) {
+            auto const &mesh = mapped.mesh(name);
+            cout << "Mapped " << name << " from " << mapped.formatGroup(mesh).name << ": "
+                 << mesh.vertices.size() << " vertex bytes, " << mesh.indices.size() << " index bytes" << endl;
+        }
+
     } catch (std::exception const& ex) {
         cerr << "--------------EXCEPTION---------------" << endl;
         cerr << ex.what() << endl;
@@ -0,0 +1,302 @@
+#include <RiEngine.hpp>
+#include <RiEngine/loaders/PipelineLoader.hpp>
+#include <iostream>
+#include "spdlog/sinks/null_sink.h"
+
+using namespace rise;
+using std::cout, std::endl, std::cerr;
+
+fs::path const sourceFolder = "game/testPipelines/spirv";
+fs::path const pipelineFolder = "game/testPipelines/pipelines";
+
+// Assembles shaders with the resources the test needs and an empty main, there is no shader
+// compiler in the test environment
+class ShaderBuilder {
+public:
+    explicit ShaderBuilder(spv::ExecutionModel model) : mModel(model) {}
+
+    ShaderBuilder &uniform(string name, uint32_t set, uint32_t binding) {
+        mUniforms.push_back({std::move(name), set, binding});
+        return *this;
+    }
+
+    ShaderBuilder &sampledImage(string name, uint32_t set, uint32_t binding) {
+        mImages.push_back({std::move(name), set, binding});
+        return *this;
+    }
+
+    ShaderBuilder &input(string name, uint32_t location) {
+        mInputs.push_back({std::move(name), 0, location});
+        return *this;
+    }
+
+    ShaderBuilder &output(string name, uint32_t location) {
+        mOutputs.push_back({std::move(name), 0, location});
+        return *this;
+    }
+
+    SPIRVBinary build() const {
+        uint32_t next = 1;
+        auto voidType = next++, functionType = next++, floatType = next++, vec4Type = next++;
+        auto imageType = next++, sampledImageType = next++;
+        auto imagePointer = next++, inputPointer = next++, outputPointer = next++;
+        auto main = next++, label = next++;
+
+        struct Ids {
+            uint32_t block = 0;
+            uint32_t pointer = 0;
+            uint32_t variable = 0;
+        };
+        auto ids = [&](vector<Binding> const &bindings, bool block) {
+            vector<Ids> result;
+            for (Size i = 0; i != bindings.size(); ++i) {
+                Ids id;
+                if (block) {
+                    id.block = next++;
+                    id.pointer = next++;
+                }
+                id.variable = next++;
+                result.push_back(id);
+            }
+            return result;
+        };
+        auto uniforms = ids(mUniforms, true);
+        auto images = ids(mImages, false);
+        auto inputs = ids(mInputs, false);
+        auto outputs = ids(mOutputs, false);
+
+        vector<uint32_t> entryPoint = {uint32_t(mModel), main};
+        append(entryPoint, text("main"));
+        for (auto const &id : inputs) {
+            entryPoint.push_back(id.variable);
+        }
+        for (auto const &id : outputs) {
+            entryPoint.push_back(id.variable);
+        }
+
+        SPIRVBinary code = {spv::MagicNumber, 0x00010000, 0, 0, 0};
+        op(code, spv::OpCapability, {spv::CapabilityShader});
+        op(code, spv::OpMemoryModel, {spv::AddressingModelLogical, spv::MemoryModelGLSL450});
+        op(code, spv::OpEntryPoint, entryPoint);
+        if (mModel == spv::ExecutionModelFragment) {
+            op(code, spv::OpExecutionMode, {main, spv::ExecutionModeOriginUpperLeft});
+        }
+
+        auto name = [&](uint32_t id, string const &value) {
+            vector<uint32_t> operands = {id};
+            append(operands, text(value));
+            op(code, spv::OpName, operands);
+        };
+        for (Size i = 0; i != mUniforms.size(); ++i) {
+            name(uniforms[i].block, mUniforms[i].name);
+            name(uniforms[i].variable, mUniforms[i].name);
+            vector<uint32_t> member = {uniforms[i].block, 0};
+            append(member, text("value"));
+            op(code, spv::OpMemberName, member);
+        }
+        for (Size i = 0; i != mImages.size(); ++i) {
+            name(images[i].variable, mImages[i].name);
+        }
+        for (Size i = 0; i != mInputs.size(); ++i) {
+            name(inputs[i].variable, mInputs[i].name);
+        }
+        for (Size i = 0; i != mOutputs.size(); ++i) {
+            name(outputs[i].variable, mOutputs[i].name);
+        }
+
+        auto descriptor = [&](uint32_t variable, Binding const &binding) {
+            op(code, spv::OpDecorate, {variable, spv::DecorationDescriptorSet, binding.set});
+            op(code, spv::OpDecorate, {variable, spv::DecorationBinding, binding.binding});
+        };
+        for (Size i = 0; i != mUniforms.size(); ++i) {
+            op(code, spv::OpDecorate, {uniforms[i].block, spv::DecorationBlock});
+            op(code, spv::OpMemberDecorate, {uniforms[i].block, 0, spv::DecorationOffset, 0});
+            descriptor(uniforms[i].variable, mUniforms[i]);
+        }
+        for (Size i = 0; i != mImages.size(); ++i) {
+            descriptor(images[i].variable, mImages[i]);
+        }
+        for (Size i = 0; i != mInputs.size(); ++i) {
+            op(code, spv::OpDecorate, {inputs[i].variable, spv::DecorationLocation, mInputs[i].binding});
+        }
+        for (Size i = 0; i != mOutputs.size(); ++i) {
+            op(code, spv::OpDecorate, {outputs[i].variable, spv::DecorationLocation, mOutputs[i].binding});
+        }
+
+        op(code, spv::OpTypeVoid, {voidType});
+        op(code, spv::OpTypeFunction, {functionType, voidType});
+        op(code, spv::OpTypeFloat, {floatType, 32});
+        op(code, spv::OpTypeVector, {vec4Type, floatType, 4});
+        op(code, spv::OpTypeImage, {imageType, floatType, spv::Dim2D, 0, 0, 0, 1, spv::ImageFormatUnknown});
+        op(code, spv::OpTypeSampledImage, {sampledImageType, imageType});
+        op(code, spv::OpTypePointer, {imagePointer, spv::StorageClassUniformConstant, sampledImageType});
+        op(code, spv::OpTypePointer, {inputPointer, spv::StorageClassInput, vec4Type});
+        op(code, spv::OpTypePointer, {outputPointer, spv::StorageClassOutput, vec4Type});
+
+        for (auto const &id : uniforms) {
+            op(code, spv::OpTypeStruct, {id.block, vec4Type});
+            op(code, spv::OpTypePointer, {id.pointer, spv::StorageClassUniform, id.block});
+            op(code, spv::OpVariable, {id.pointer, id.variable, spv::StorageClassUniform});
+        }
+        for (auto const &id : images) {
+            op(code, spv::OpVariable, {imagePointer, id.variable, spv::StorageClassUniformConstant});
+        }
+        for (auto const &id : inputs) {
+            op(code, spv::OpVariable, {inputPointer, id.variable, spv::StorageClassInput});
+        }
+        for (auto const &id : outputs) {
+            op(code, spv::OpVariable, {outputPointer, id.variable, spv::StorageClassOutput});
+        }
+
+        op(code, spv::OpFunction, {voidType, main, spv::FunctionControlMaskNone, functionType});
+        op(code, spv::OpLabel, {label});
+        op(code, spv::OpReturn, {});
+        op(code, spv::OpFunctionEnd, {});
+
+        code[3] = next;
+        return code;
+    }
+
+private:
+    struct Binding {
+        string name;
+        uint32_t set;
+        // location of stage inputs and outputs
+        uint32_t binding;
+    };
+
+    static vector<uint32_t> text(string const &value) {
+        vector<uint32_t> words(value.size() / 4 + 1, 0);
+        memcpy(words.data(), value.data(), value.size());
+        return words;
+    }
+
+    static void append(vector<uint32_t> &dst, vector<uint32_t> const &src) {
+        dst.insert(dst.end(), src.begin(), src.end());
+    }
+
+    static void op(SPIRVBinary &code, spv::Op opcode, vector<uint32_t> const &operands) {
+        code.push_back(uint32_t(operands.size() + 1) << 16u | uint32_t(opcode));
+        append(code, operands);
+    }
+
+    spv::ExecutionModel mModel;
+    vector<Binding> mUniforms;
+    vector<Binding> mImages;
+    vector<Binding> mInputs;
+    vector<Binding> mOutputs;
+};
+
+void writeShader(fs::path const &path, SPIRVBinary const &binary) {
+    ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<char const *>(binary.data()), std::streamsize(binary.size() * sizeof(uint32_t)));
+}
+
+ShaderBuilder vertexShader() {
+    return ShaderBuilder(spv::ExecutionModelVertex).uniform("Camera", 0, 0).input("inPositions", 0)
+            .input("inNormals", 1);
+}
+
+ShaderBuilder litShader() {
+    return ShaderBuilder(spv::ExecutionModelFragment).sampledImage("albedo", 0, 1).uniform("Material", 1, 0)
+            .output("outColor", 0);
+}
+
+void convert(string const &flatFragment) {
+    PipelineConverter converter(sourceFolder);
+    converter.addPipeline("lit", "basicVert", "litFrag", true);
+    converter.addPipeline("flat", "basicVert", flatFragment, true);
+    converter.convert(pipelineFolder);
+}
+
+int main() {
+    Size failed = 0;
+    auto check = [&](bool condition, string_view what) {
+        if (!condition) {
+            cerr << what << endl;
+            ++failed;
+        }
+    };
+
+    try {
+        spdlog::set_default_logger(spdlog::null_logger_mt("test-logger"));
+
+        fs::remove_all("game/testPipelines");
+        fs::create_directories(sourceFolder);
+        writeShader(sourceFolder / "basicVert.spv", vertexShader().build());
+        writeShader(sourceFolder / "litFrag.spv", litShader().build());
+        writeShader(sourceFolder / "flatFrag.spv", ShaderBuilder(spv::ExecutionModelFragment)
+                .output("outColor", 0).build());
+        writeShader(sourceFolder / "detailFrag.spv", ShaderBuilder(spv::ExecutionModelFragment)
+                .sampledImage("detail", 0, 3).output("outColor", 0).build());
+        convert("flatFrag");
+
+        // both pipelines share basicVert
+        PipelineImporter importer(pipelineFolder);
+        importer.import("lit");
+        importer.import("flat");
+        auto pipelines = importer.load();
+        auto lit = pipelines.pipeline("lit");
+        auto flat = pipelines.pipeline("flat");
+
+        check(pipelines.uniform(lit, "Camera").shaderIndex == pipelines.uniform(flat, "Camera").shaderIndex,
+                "shared vertex shader loaded twice");
+        check(pipelines.binding(pipelines.sampledImage(lit, "albedo")).binding == 1, "albedo binding");
+        check(pipelines.generation() == 0, "generation after load");
+
+        // a changed shared shader changes both pipelines
+        writeShader(sourceFolder / "basicVert.spv", vertexShader().uniform("Skin", 0, 2).build());
+        convert("flatFrag");
+        vector<fs::path> changed = {"basicVert.spv", "basicVert.reflect"};
+        check(pipelines.reload(changed) == 2, "reload of the shared shader");
+        check(pipelines.generation() == 1, "generation after shader reload");
+        check(pipelines.generation(lit) == 1 && pipelines.generation(flat) == 1, "pipeline generations");
+        check(pipelines.binding(pipelines.uniform(flat, "Skin")).binding == 2, "reloaded uniform");
+
+        // a changed description loads a shader that was not imported before
+        convert("detailFrag");
+        changed = {"flat.rise"};
+        check(pipelines.reload(changed) == 1, "reload of a pipeline description");
+        check(pipelines.generation() == 2, "generation after description reload");
+        check(pipelines.generation(lit) == 1 && pipelines.generation(flat) == 2, "only flat changed");
+        check(pipelines.binding(pipelines.sampledImage(flat, "detail")).binding == 3, "new shader resource");
+
+        // a damaged shader written in place keeps the previous state
+        {
+            ofstream file(pipelineFolder / "litFrag.spv", std::ios::binary | std::ios::trunc);
+            file << "not SPIR-V";
+        }
+        changed = {"litFrag.spv"};
+        check(pipelines.reload(changed) == 0, "damaged shader was reloaded");
+        check(pipelines.generation() == 2 && pipelines.generation(lit) == 1, "damaged shader changed generations");
+        check(pipelines.binding(pipelines.sampledImage(lit, "albedo")).binding == 1, "damaged shader changed state");
+
+        // set 0 binding 0 declared as a uniform by the vertex shader and as an image here fails the
+        // layouts after the swap, the swap is undone
+        writeShader(sourceFolder / "litFrag.spv", ShaderBuilder(spv::ExecutionModelFragment)
+                .sampledImage("albedo", 0, 0).output("outColor", 0).build());
+        convert("detailFrag");
+        changed = {"litFrag.spv", "litFrag.reflect"};
+        check(pipelines.reload(changed) == 0, "conflicting shader was reloaded");
+        check(pipelines.generation() == 2 && pipelines.generation(lit) == 1, "rollback changed generations");
+        check(pipelines.binding(pipelines.sampledImage(lit, "albedo")).binding == 1, "rollback lost the old shader");
+        check(pipelines.binding(pipelines.uniform(lit, "Material")).set == 1, "rollback lost old resources");
+
+#ifdef __linux__
+        // converter outputs are renamed into place, the watcher sees them on the next poll
+        PipelineWatcher watcher(pipelines);
+        check(watcher.poll() == 0, "watcher reported changes before any write");
+        writeShader(sourceFolder / "litFrag.spv", litShader().uniform("Fog", 2, 0).build());
+        convert("detailFrag");
+        check(watcher.poll() == 2, "watcher missed the converted pipelines");
+        check(pipelines.generation(lit) == pipelines.generation(), "watcher did not reload lit");
+        check(pipelines.binding(pipelines.uniform(lit, "Fog")).set == 2, "watched uniform");
+#endif
+    } catch (std::exception const &ex) {
+        cerr << ex.what() << endl;
+        ++failed;
+    }
+
+    cout << (failed == 0 ? "OK" : "FAILED") << endl;
+    return failed == 0 ? 0 : 1;
+}